@@ -0,0 +1,10 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmAIController.h"
+
+#include "AmGridPathFollowingComponent.h"
+
+AAmAIController::AAmAIController(const FObjectInitializer& ObjectInitializer) :
+	Super(ObjectInitializer.SetDefaultSubobjectClass<UAmGridPathFollowingComponent>(TEXT("PathFollowingComponent")))
+{
+}
@@ -0,0 +1,21 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+
+#include "AmAIController.generated.h"
+
+/**
+ * AAmAIController is the base class of bot controllers, its pawn follows grid paths with UAmGridPathFollowingComponent.
+ */
+UCLASS()
+class AAmAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+
+	AAmAIController(const FObjectInitializer& ObjectInitializer);
+};
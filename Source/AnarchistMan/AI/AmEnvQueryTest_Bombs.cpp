@@ -57,8 +57,8 @@ void UAmEnvQueryTest_Bombs::RunTest(FEnvQueryInstance& QueryInstance) const
 
 	int32 ItemsNum = QueryInstance.Items.Num();
 
+	// Computed once the first item is known to be reachable.
 	TArray<float> ReachableTilesCost;
-	GridNavMesh->GetReachableTiles(Cast<APawn>(QueryOwner)->GetController(), ReachableTilesCost, AddMovementStartDelay.GetValue());
 
 	FEnvQueryInstance::ItemIterator It(this, QueryInstance);
 	It.IgnoreTimeLimit();
@@ -69,12 +69,19 @@ void UAmEnvQueryTest_Bombs::RunTest(FEnvQueryInstance& QueryInstance) const
 
 		float Score = TNumericLimits<float>::Max();
 
-		if (ReachableTilesCost.IsValidIndex(NodeRef) &&
-			ReachableTilesCost[NodeRef] != TNumericLimits<int64>::Max() &&
-			GridNavMesh->GetTileCost(ItemLocation) <= ETileNavCost::DEFAULT &&
-			GridNavMesh->GetTileTimeout(ItemLocation) == AAmGridNavMesh::TIMEOUT_UNSET)
+		if (GridNavMesh->IsValidRef(NodeRef) &&
+			GridNavMesh->AreNodesConnected(ActorNode, NodeRef, false) &&
+			GridNavMesh->GetNodeTimeout(NodeRef) == AAmGridNavMesh::TIMEOUT_UNSET)
 		{
-			Score = float(ReachableTilesCost[NodeRef]);
+			if (ReachableTilesCost.Num() == 0)
+			{
+				GridNavMesh->GetReachableTiles(Cast<APawn>(QueryOwner)->GetController(), ReachableTilesCost, AddMovementStartDelay.GetValue());
+			}
+
+			if (ReachableTilesCost.IsValidIndex(NodeRef) && ReachableTilesCost[NodeRef] != TNumericLimits<float>::Max())
+			{
+				Score = float(ReachableTilesCost[NodeRef]);
+			}
 		}
 
 		It.SetScore(TestPurpose, FilterType, Score, FloatValueMin.GetValue(), FloatValueMax.GetValue());
@@ -0,0 +1,230 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridAStar.h"
+
+#include "AmGridNavMesh.h"
+#include "AmGridQueryFilter.h"
+
+void FAmGridAStar::Reserve(int32 NumNodes)
+{
+	if (Epochs.Num() == NumNodes)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Grid_Navigation_SearchAllocations);
+
+	Epochs.Init(0, NumNodes);
+	TraversalCosts.SetNumUninitialized(NumNodes);
+	TotalCosts.SetNumUninitialized(NumNodes);
+	Parents.SetNumUninitialized(NumNodes);
+	HeapIndices.SetNumUninitialized(NumNodes);
+
+	// A tile is in the heap at most once.
+	Heap.Empty(NumNodes);
+
+	Epoch = 0;
+}
+
+EGraphAStarResult FAmGridAStar::FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& Filter, TArray<FAmGridPathNode>& OutPath)
+{
+	NodesExpanded = 0;
+
+	if (!(Grid.IsValidIndex(StartNodeRef) && Grid.IsWalkable(StartNodeRef) && Grid.IsValidIndex(EndNodeRef) && Grid.IsWalkable(EndNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == EndNodeRef)
+	{
+		return SearchSuccess;
+	}
+
+	Reserve(Grid.Num());
+
+	Epoch++;
+	if (Epoch == 0)
+	{
+		Epochs.Init(0, Grid.Num());
+		Epoch = 1;
+	}
+
+	Heap.Reset();
+
+	// Kick off the search with the first node.
+	Epochs[StartNodeRef] = Epoch;
+	TraversalCosts[StartNodeRef] = 0;
+	TotalCosts[StartNodeRef] = GetHeuristicCost(Filter, StartNodeRef, EndNodeRef);
+	Parents[StartNodeRef] = INDEX_NONE;
+	HeapPush(StartNodeRef);
+
+	FNodeRef BestNodeRef = StartNodeRef;
+	double BestHeuristicCost = TotalCosts[StartNodeRef];
+
+	while (Heap.Num() > 0)
+	{
+		const FNodeRef NodeRef = HeapPop();
+
+		if (NodeRef == EndNodeRef)
+		{
+			BestNodeRef = EndNodeRef;
+			BestHeuristicCost = 0.f;
+			break;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+		NodesExpanded++;
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+		INC_DWORD_STAT_BY(STAT_Grid_Navigation_NeighboursVisited, NeighbourCount);
+
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(NodeRef, NeighbourIdx);
+
+			if (NeighbourNodeRef == Parents[NodeRef] || !Filter.IsTraversalAllowed(NodeRef, NeighbourNodeRef))
+			{
+				continue;
+			}
+
+			const int64 TraversalCost = TraversalCosts[NodeRef] + Filter.GetNodeTraversalCost(TraversalCosts[NodeRef], NeighbourNodeRef);
+
+			if (IsVisited(NeighbourNodeRef))
+			{
+				if (TraversalCost >= TraversalCosts[NeighbourNodeRef])
+				{
+					continue;
+				}
+
+				// Traversal costs depend on the time a tile is entered, so a closed tile is reopened if it is reached cheaper.
+				const double HeuristicCost = TotalCosts[NeighbourNodeRef] - double(TraversalCosts[NeighbourNodeRef]);
+				TraversalCosts[NeighbourNodeRef] = TraversalCost;
+				TotalCosts[NeighbourNodeRef] = double(TraversalCost) + HeuristicCost;
+				Parents[NeighbourNodeRef] = NodeRef;
+
+				if (HeapIndices[NeighbourNodeRef] == INDEX_NONE)
+				{
+					HeapPush(NeighbourNodeRef);
+				}
+				else
+				{
+					HeapSiftUp(HeapIndices[NeighbourNodeRef]);
+				}
+				continue;
+			}
+
+			const double HeuristicCost = GetHeuristicCost(Filter, NeighbourNodeRef, EndNodeRef);
+
+			Epochs[NeighbourNodeRef] = Epoch;
+			TraversalCosts[NeighbourNodeRef] = TraversalCost;
+			TotalCosts[NeighbourNodeRef] = double(TraversalCost) + HeuristicCost;
+			Parents[NeighbourNodeRef] = NodeRef;
+			HeapPush(NeighbourNodeRef);
+
+			if (HeuristicCost < BestHeuristicCost)
+			{
+				BestHeuristicCost = HeuristicCost;
+				BestNodeRef = NeighbourNodeRef;
+			}
+		}
+	}
+
+	EGraphAStarResult Result = BestHeuristicCost == 0.f ? SearchSuccess : GoalUnreachable;
+
+	// No point to waste perf creating the path if querier doesn't want it.
+	if (Result == SearchSuccess || Filter.WantsPartialSolution())
+	{
+		StorePath(BestNodeRef, StartNodeRef, OutPath);
+	}
+
+	return Result;
+}
+
+double FAmGridAStar::GetHeuristicCost(const FAmGridQueryFilter& Filter, FNodeRef NodeRef, FNodeRef EndNodeRef) const
+{
+	return Filter.GetHeuristicCost(NodeRef, EndNodeRef) * Filter.GetHeuristicScale();
+}
+
+void FAmGridAStar::StorePath(FNodeRef NodeRef, FNodeRef StartNodeRef, TArray<FAmGridPathNode>& OutPath) const
+{
+	int32 PathLength = 0;
+	for (FNodeRef PathNodeRef = NodeRef; PathNodeRef != StartNodeRef; PathNodeRef = Parents[PathNodeRef])
+	{
+		PathLength++;
+	}
+
+	if (OutPath.Max() < PathLength)
+	{
+		INC_DWORD_STAT(STAT_Grid_Navigation_SearchAllocations);
+	}
+
+	OutPath.Reset(PathLength);
+	OutPath.AddUninitialized(PathLength);
+
+	for (int32 Index = PathLength - 1; Index >= 0; Index--)
+	{
+		OutPath[Index] = { NodeRef, TraversalCosts[NodeRef] };
+		NodeRef = Parents[NodeRef];
+	}
+}
+
+void FAmGridAStar::HeapPush(FNodeRef NodeRef)
+{
+	HeapSet(Heap.Add(NodeRef), NodeRef);
+	HeapSiftUp(Heap.Num() - 1);
+}
+
+FNodeRef FAmGridAStar::HeapPop()
+{
+	const FNodeRef NodeRef = Heap[0];
+	HeapIndices[NodeRef] = INDEX_NONE;
+
+	const FNodeRef LastNodeRef = Heap.Pop(false);
+	if (Heap.Num() > 0)
+	{
+		HeapSet(0, LastNodeRef);
+		HeapSiftDown(0);
+	}
+
+	return NodeRef;
+}
+
+void FAmGridAStar::HeapSiftUp(int32 Index)
+{
+	const FNodeRef NodeRef = Heap[Index];
+	while (Index > 0)
+	{
+		const int32 ParentIndex = (Index - 1) / 2;
+		if (!(TotalCosts[NodeRef] < TotalCosts[Heap[ParentIndex]]))
+		{
+			break;
+		}
+		HeapSet(Index, Heap[ParentIndex]);
+		Index = ParentIndex;
+	}
+	HeapSet(Index, NodeRef);
+}
+
+void FAmGridAStar::HeapSiftDown(int32 Index)
+{
+	const FNodeRef NodeRef = Heap[Index];
+	while (true)
+	{
+		int32 ChildIndex = Index * 2 + 1;
+		if (ChildIndex >= Heap.Num())
+		{
+			break;
+		}
+		if (ChildIndex + 1 < Heap.Num() && TotalCosts[Heap[ChildIndex + 1]] < TotalCosts[Heap[ChildIndex]])
+		{
+			ChildIndex++;
+		}
+		if (!(TotalCosts[Heap[ChildIndex]] < TotalCosts[NodeRef]))
+		{
+			break;
+		}
+		HeapSet(Index, Heap[ChildIndex]);
+		Index = ChildIndex;
+	}
+	HeapSet(Index, NodeRef);
+}
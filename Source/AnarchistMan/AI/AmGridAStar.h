@@ -0,0 +1,82 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+class FAmGridQueryFilter;
+
+/**
+ * FAmGridAStar is the plain A* search over grid tiles.
+ * Search state lives in dense arrays indexed by FNodeRef and stamped with the search epoch, so nothing is cleared between searches.
+ * An instance is meant to be kept per thread: once its arrays are sized to the grid, a search doesn't allocate.
+ */
+class FAmGridAStar
+{
+public:
+
+	// Size the search state for a grid of NumNodes tiles.
+	void Reserve(int32 NumNodes);
+
+	/**
+	 * Find a path from StartNodeRef to EndNodeRef.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 * If the goal is unreachable, the path to the node closest to the goal is stored.
+	 */
+	EGraphAStarResult FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& Filter, TArray<FAmGridPathNode>& OutPath);
+
+	// Number of nodes expanded by the last search.
+	FORCEINLINE int32 GetNodesExpanded() const
+	{
+		return NodesExpanded;
+	}
+
+private:
+
+	FORCEINLINE bool IsVisited(FNodeRef NodeRef) const
+	{
+		return Epochs[NodeRef] == Epoch;
+	}
+
+	double GetHeuristicCost(const FAmGridQueryFilter& Filter, FNodeRef NodeRef, FNodeRef EndNodeRef) const;
+
+	void StorePath(FNodeRef NodeRef, FNodeRef StartNodeRef, TArray<FAmGridPathNode>& OutPath) const;
+
+	/* Binary heap of open nodes ordered by total cost, HeapIndices allow updating a node in place. */
+
+	void HeapPush(FNodeRef NodeRef);
+
+	FNodeRef HeapPop();
+
+	void HeapSiftUp(int32 Index);
+
+	void HeapSiftDown(int32 Index);
+
+	FORCEINLINE void HeapSet(int32 Index, FNodeRef NodeRef)
+	{
+		Heap[Index] = NodeRef;
+		HeapIndices[NodeRef] = Index;
+	}
+
+private:
+
+	// State of a tile is only valid if its epoch is the current one.
+	TArray<uint32> Epochs;
+
+	TArray<int64> TraversalCosts;
+
+	TArray<double> TotalCosts;
+
+	TArray<FNodeRef> Parents;
+
+	// Position of a tile in Heap, INDEX_NONE once the tile is closed.
+	TArray<int32> HeapIndices;
+
+	TArray<FNodeRef> Heap;
+
+	uint32 Epoch = 0;
+
+	int32 NodesExpanded = 0;
+};
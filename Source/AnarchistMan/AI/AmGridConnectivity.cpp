@@ -0,0 +1,186 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridConnectivity.h"
+
+FAmGridConnectivity::FAmGridConnectivity(ETileType InMaxTileType) :
+	MaxTileType(InMaxTileType)
+{
+}
+
+void FAmGridConnectivity::Update(const FAmGridData& Grid)
+{
+	if (Parents.Num() != Grid.Num())
+	{
+		Rebuild(Grid);
+		return;
+	}
+
+	if (GridChangeCount == Grid.GetChangeCount())
+	{
+		return;
+	}
+
+	if (!Grid.GetChangedTiles(GridChangeCount, ChangedTiles))
+	{
+		Rebuild(Grid);
+		return;
+	}
+
+	GridChangeCount = Grid.GetChangeCount();
+
+	// Dangers are logged too, only tiles that opened or closed are processed.
+	for (FNodeRef NodeRef : ChangedTiles)
+	{
+		const bool bIsOpen = IsOpenType(Grid, NodeRef);
+		if (bIsOpen && !OpenTiles[NodeRef])
+		{
+			OpenTile(Grid, NodeRef);
+		}
+		else if (!bIsOpen && OpenTiles[NodeRef])
+		{
+			CloseTile(Grid, NodeRef);
+		}
+	}
+}
+
+bool FAmGridConnectivity::IsConnected(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef) const
+{
+	if (!(Grid.IsValidIndex(StartNodeRef) && Grid.IsValidIndex(EndNodeRef) && OpenTiles[EndNodeRef]))
+	{
+		return false;
+	}
+
+	const int32 EndRegion = Find(EndNodeRef);
+
+	if (OpenTiles[StartNodeRef])
+	{
+		return Find(StartNodeRef) == EndRegion;
+	}
+
+	// Leaving a closed tile is allowed, so any open neighbour will do.
+	const int32 NeighbourCount = Grid.GetNeighbourCount(StartNodeRef);
+	for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+	{
+		const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(StartNodeRef, NeighbourIdx);
+		if (OpenTiles[NeighbourNodeRef] && Find(NeighbourNodeRef) == EndRegion)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FAmGridConnectivity::Rebuild(const FAmGridData& Grid)
+{
+	GridChangeCount = Grid.GetChangeCount();
+
+	OpenTiles.Init(false, Grid.Num());
+	Parents.SetNumUninitialized(Grid.Num());
+	Ranks.Init(0, Grid.Num());
+
+	for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+	{
+		Parents[NodeRef] = NodeRef;
+	}
+
+	for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+	{
+		if (IsOpenType(Grid, NodeRef))
+		{
+			OpenTile(Grid, NodeRef);
+		}
+	}
+}
+
+void FAmGridConnectivity::OpenTile(const FAmGridData& Grid, FNodeRef NodeRef)
+{
+	OpenTiles[NodeRef] = true;
+
+	const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+	for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+	{
+		const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(NodeRef, NeighbourIdx);
+		if (OpenTiles[NeighbourNodeRef])
+		{
+			Union(NodeRef, NeighbourNodeRef);
+		}
+	}
+}
+
+void FAmGridConnectivity::CloseTile(const FAmGridData& Grid, FNodeRef NodeRef)
+{
+	OpenTiles[NodeRef] = false;
+
+	// Union-find can't split, so flood the open tiles around the closed one and relabel every region found.
+	// Only the region the tile belonged to is visited.
+	Epoch++;
+	if (VisitedEpochs.Num() != Grid.Num() || Epoch == 0)
+	{
+		VisitedEpochs.Init(0, Grid.Num());
+		Epoch = 1;
+	}
+
+	const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+	for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+	{
+		const FNodeRef RootNodeRef = Grid.GetNeighbour(NodeRef, NeighbourIdx);
+		if (!OpenTiles[RootNodeRef] || VisitedEpochs[RootNodeRef] == Epoch)
+		{
+			continue;
+		}
+
+		RegionTiles.Reset();
+		RegionTiles.Add(RootNodeRef);
+		VisitedEpochs[RootNodeRef] = Epoch;
+
+		for (int32 Index = 0; Index < RegionTiles.Num(); Index++)
+		{
+			const FNodeRef CurrentNodeRef = RegionTiles[Index];
+
+			const int32 CurrentNeighbourCount = Grid.GetNeighbourCount(CurrentNodeRef);
+			for (int32 CurrentNeighbourIdx = 0; CurrentNeighbourIdx < CurrentNeighbourCount; CurrentNeighbourIdx++)
+			{
+				const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(CurrentNodeRef, CurrentNeighbourIdx);
+				if (OpenTiles[NeighbourNodeRef] && VisitedEpochs[NeighbourNodeRef] != Epoch)
+				{
+					VisitedEpochs[NeighbourNodeRef] = Epoch;
+					RegionTiles.Add(NeighbourNodeRef);
+				}
+			}
+		}
+
+		// Every tile of the region points straight to the new root.
+		for (FNodeRef RegionNodeRef : RegionTiles)
+		{
+			Parents[RegionNodeRef] = RootNodeRef;
+			Ranks[RegionNodeRef] = 0;
+		}
+		Ranks[RootNodeRef] = RegionTiles.Num() > 1 ? 1 : 0;
+	}
+
+	Parents[NodeRef] = NodeRef;
+	Ranks[NodeRef] = 0;
+}
+
+void FAmGridConnectivity::Union(FNodeRef NodeRefA, FNodeRef NodeRefB)
+{
+	int32 RootA = Find(NodeRefA);
+	int32 RootB = Find(NodeRefB);
+
+	if (RootA == RootB)
+	{
+		return;
+	}
+
+	if (Ranks[RootA] < Ranks[RootB])
+	{
+		Swap(RootA, RootB);
+	}
+
+	Parents[RootB] = RootA;
+	if (Ranks[RootA] == Ranks[RootB])
+	{
+		Ranks[RootA]++;
+	}
+}
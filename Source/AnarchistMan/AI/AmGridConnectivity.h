@@ -0,0 +1,81 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/AmGridData.h"
+
+/**
+ * FAmGridConnectivity labels connected regions of open tiles, so "can one tile be reached from another" is answered in constant time.
+ * A tile is open if it is walkable and its type is not above MaxTileType, e.g. DEFAULT for block free routes.
+ * Regions are kept in a union-find structure: a tile that opens merges the regions around it,
+ * a tile that closes relabels only the region it has split.
+ */
+class FAmGridConnectivity
+{
+public:
+
+	explicit FAmGridConnectivity(ETileType InMaxTileType);
+
+	// Bring the regions up to date with the grid, they are rebuilt from scratch if the grid size changed or the change log overflowed.
+	void Update(const FAmGridData& Grid);
+
+	FORCEINLINE bool IsOpen(FNodeRef NodeRef) const
+	{
+		return OpenTiles[NodeRef];
+	}
+
+	/**
+	 * Check if EndNodeRef can be reached from StartNodeRef through open tiles.
+	 * The start tile itself doesn't have to be open, e.g. an agent standing on its own bomb.
+	 */
+	bool IsConnected(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef) const;
+
+private:
+
+	void Rebuild(const FAmGridData& Grid);
+
+	void OpenTile(const FAmGridData& Grid, FNodeRef NodeRef);
+
+	void CloseTile(const FAmGridData& Grid, FNodeRef NodeRef);
+
+	FORCEINLINE bool IsOpenType(const FAmGridData& Grid, FNodeRef NodeRef) const
+	{
+		return Grid.IsWalkable(NodeRef) && Grid.GetType(NodeRef) <= MaxTileType;
+	}
+
+	// Find the region of the tile, union by rank keeps the trees shallow, so no path compression is needed.
+	FORCEINLINE int32 Find(FNodeRef NodeRef) const
+	{
+		while (Parents[NodeRef] != NodeRef)
+		{
+			NodeRef = Parents[NodeRef];
+		}
+		return NodeRef;
+	}
+
+	void Union(FNodeRef NodeRefA, FNodeRef NodeRefB);
+
+private:
+
+	ETileType MaxTileType;
+
+	uint64 GridChangeCount = 0;
+
+	TBitArray<> OpenTiles;
+
+	TArray<FNodeRef> Parents;
+
+	TArray<uint8> Ranks;
+
+	/* Scratch buffers reused between updates. */
+
+	TArray<FNodeRef> ChangedTiles;
+
+	// Tiles of the regions found by the last relabel, grouped by region.
+	TArray<FNodeRef> RegionTiles;
+
+	TArray<uint32> VisitedEpochs;
+
+	uint32 Epoch = 0;
+};
@@ -0,0 +1,212 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridData.h"
+
+const int32 FAmGridData::NeighbourCounts[1 << EAmGridDirection::MAX] =
+{
+	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+const uint8 FAmGridData::NeighbourDirections[1 << EAmGridDirection::MAX][EAmGridDirection::MAX] =
+{
+	{ 0, 0, 0, 0 },
+	{ 0, 0, 0, 0 },
+	{ 1, 0, 0, 0 },
+	{ 0, 1, 0, 0 },
+	{ 2, 0, 0, 0 },
+	{ 0, 2, 0, 0 },
+	{ 1, 2, 0, 0 },
+	{ 0, 1, 2, 0 },
+	{ 3, 0, 0, 0 },
+	{ 0, 3, 0, 0 },
+	{ 1, 3, 0, 0 },
+	{ 0, 1, 3, 0 },
+	{ 2, 3, 0, 0 },
+	{ 0, 2, 3, 0 },
+	{ 1, 2, 3, 0 },
+	{ 0, 1, 2, 3 },
+};
+
+void FAmGridData::Init(int32 InRows, int32 InColumns)
+{
+	Rows = InRows;
+	Columns = InColumns;
+
+	DirectionOffsets[EAmGridDirection::LEFT] = -1;
+	DirectionOffsets[EAmGridDirection::RIGHT] = 1;
+	DirectionOffsets[EAmGridDirection::UP] = -Columns;
+	DirectionOffsets[EAmGridDirection::DOWN] = Columns;
+
+	Tiles.SetNumUninitialized(Rows * Columns);
+	ChangeLog.Init(0, CHANGE_LOG_SIZE);
+
+	for (int32 Y = 0; Y < Rows; Y++)
+	{
+		for (int32 X = 0; X < Columns; X++)
+		{
+			FAmGridTile& Tile = Tiles[Y * Columns + X];
+			Tile.Flags = IsWallLocation(X, Y) ? EAmGridTileFlags::WALL : EAmGridTileFlags::NONE;
+			Tile.Occupants = 0;
+
+			uint8 NeighbourMask = 0;
+			if (X > 0 && !IsWallLocation(X - 1, Y))
+			{
+				NeighbourMask |= 1 << EAmGridDirection::LEFT;
+			}
+			if (X + 1 < Columns && !IsWallLocation(X + 1, Y))
+			{
+				NeighbourMask |= 1 << EAmGridDirection::RIGHT;
+			}
+			if (Y > 0 && !IsWallLocation(X, Y - 1))
+			{
+				NeighbourMask |= 1 << EAmGridDirection::UP;
+			}
+			if (Y + 1 < Rows && !IsWallLocation(X, Y + 1))
+			{
+				NeighbourMask |= 1 << EAmGridDirection::DOWN;
+			}
+			Tile.NeighbourMask = NeighbourMask;
+		}
+	}
+
+	Reset();
+}
+
+void FAmGridData::Reset()
+{
+	for (FAmGridTile& Tile : Tiles)
+	{
+		Tile.DangerStart = 0.f;
+		Tile.Type = ETileType::DEFAULT;
+		Tile.Flags &= ~EAmGridTileFlags::DANGER;
+	}
+
+	DangerIntervals.Reset();
+
+	// Every tile has changed, overflow the log so incremental consumers start over.
+	// A consumer synced right before has to be more than the log size behind to see the overflow.
+	ChangeCount += CHANGE_LOG_SIZE + 1;
+}
+
+bool FAmGridData::GetChangedTiles(uint64 SinceChangeCount, TArray<FNodeRef>& OutNodeRefs) const
+{
+	OutNodeRefs.Reset();
+
+	if (ChangeCount - SinceChangeCount > CHANGE_LOG_SIZE)
+	{
+		return false;
+	}
+
+	for (uint64 Index = SinceChangeCount; Index < ChangeCount; Index++)
+	{
+		OutNodeRefs.Add(ChangeLog[Index % CHANGE_LOG_SIZE]);
+	}
+
+	return true;
+}
+
+const FAmGridDangerIntervals& FAmGridData::GetDangerIntervals(FNodeRef NodeRef) const
+{
+	static const FAmGridDangerIntervals NoIntervals;
+
+	const FAmGridDangerIntervals* Intervals = DangerIntervals.Find(NodeRef);
+	return Intervals ? *Intervals : NoIntervals;
+}
+
+void FAmGridData::SetDangerIntervals(FNodeRef NodeRef, TArrayView<const FAmGridDangerInterval> Intervals)
+{
+	FAmGridTile& Tile = Tiles[NodeRef];
+
+	if (Intervals.Num() == 0)
+	{
+		if (DangerIntervals.Remove(NodeRef) > 0)
+		{
+			Tile.DangerStart = 0.f;
+			Tile.Flags &= ~EAmGridTileFlags::DANGER;
+			MarkChanged(NodeRef);
+		}
+		return;
+	}
+
+	FAmGridDangerIntervals SortedIntervals(Intervals);
+	SortedIntervals.Sort([](const FAmGridDangerInterval& A, const FAmGridDangerInterval& B)
+	{
+		return A.Start < B.Start;
+	});
+
+	FAmGridDangerIntervals& TileIntervals = DangerIntervals.FindOrAdd(NodeRef);
+	if (TileIntervals == SortedIntervals)
+	{
+		return;
+	}
+
+	TileIntervals = MoveTemp(SortedIntervals);
+	Tile.DangerStart = TileIntervals[0].Start;
+	Tile.Flags |= EAmGridTileFlags::DANGER;
+	MarkChanged(NodeRef);
+}
+
+float FAmGridData::GetDangerChangeTime(FNodeRef NodeRef, float TimeBeforeTileMin, float TimeAfterTileMax) const
+{
+	float ChangeTime = TNumericLimits<float>::Max();
+	if (!HasTimeout(NodeRef))
+	{
+		return ChangeTime;
+	}
+
+	for (const FAmGridDangerInterval& Interval : DangerIntervals.FindChecked(NodeRef))
+	{
+		// The tile is passed during the interval while the grid time is between these.
+		const float OverlapStart = Interval.Start - TimeAfterTileMax;
+		const float OverlapEnd = Interval.End - TimeBeforeTileMin;
+
+		if (Time < OverlapStart)
+		{
+			// Intervals are sorted by start, the later ones start overlapping even later.
+			ChangeTime = FMath::Min(ChangeTime, OverlapStart);
+			break;
+		}
+
+		if (Time <= OverlapEnd)
+		{
+			ChangeTime = FMath::Min(ChangeTime, OverlapEnd);
+		}
+	}
+	return ChangeTime;
+}
+
+float FAmGridData::GetLastDangerEnd() const
+{
+	float LastDangerEnd = TIMEOUT_UNSET;
+	for (const TPair<FNodeRef, FAmGridDangerIntervals>& TileIntervals : DangerIntervals)
+	{
+		for (const FAmGridDangerInterval& Interval : TileIntervals.Value)
+		{
+			LastDangerEnd = FMath::Max(LastDangerEnd, Interval.End);
+		}
+	}
+	return LastDangerEnd;
+}
+
+bool FAmGridData::IsDangerousSlow(FNodeRef NodeRef, float StartTime, float EndTime) const
+{
+	for (const FAmGridDangerInterval& Interval : DangerIntervals.FindChecked(NodeRef))
+	{
+		if (Interval.Start > EndTime)
+		{
+			break;
+		}
+
+		if (StartTime <= Interval.End)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FAmGridData::IsWallLocation(int32 X, int32 Y) const
+{
+	// Outer border and pillars on every tile with both coordinates even.
+	return X == 0 || Y == 0 || (Y % 2 == 0 && X % 2 == 0);
+}
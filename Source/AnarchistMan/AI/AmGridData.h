@@ -0,0 +1,291 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Navigation/NavLocalGridData.h"
+#include "Game/AmUtils.h"
+
+typedef FNavLocalGridData::FNodeRef FNodeRef;
+
+namespace EAmGridTileFlags {
+enum Type : uint8
+{
+	NONE = 0,
+	// The tile has danger intervals set.
+	DANGER = 1 << 0,
+	// The tile is a static wall (outer border or pillar) and is never walkable.
+	WALL = 1 << 1,
+};
+}
+
+namespace EAmGridDirection {
+enum Type : uint8
+{
+	LEFT,
+	RIGHT,
+	UP,
+	DOWN,
+	MAX,
+};
+}
+
+/**
+ * Packed state of a single grid tile.
+ * Everything a search reads about a tile lives in one 8 byte record, so a cache line holds 8 neighbouring tiles.
+ */
+struct FAmGridTile
+{
+	// World time the earliest danger interval of the tile starts at, only meaningful when the DANGER flag is set.
+	float DangerStart;
+
+	ETileType Type;
+
+	uint8 Flags;
+
+	// Bit per EAmGridDirection, set if the neighbour in that direction is not a wall.
+	uint8 NeighbourMask;
+
+	// Number of characters standing on the tile.
+	uint8 Occupants;
+};
+
+static_assert(sizeof(FAmGridTile) == 8, "FAmGridTile is expected to stay packed.");
+
+// Span of world time a tile is covered by an explosion.
+struct FAmGridDangerInterval
+{
+	float Start;
+	float End;
+
+	bool operator==(const FAmGridDangerInterval& Other) const
+	{
+		return Start == Other.Start && End == Other.End;
+	}
+};
+
+typedef TArray<FAmGridDangerInterval, TInlineAllocator<2>> FAmGridDangerIntervals;
+
+// Tile on a search frontier or a result path together with the cost accumulated to reach it.
+struct FAmGridPathNode
+{
+	FNodeRef NodeRef;
+	int64 TraversalCost;
+};
+
+/**
+ * FAmGridData stores the navigation state of the whole arena as a flat array of packed tiles indexed by FNodeRef.
+ * Danger intervals are kept in absolute world time, several per tile, and queried relative to the grid time.
+ */
+class FAmGridData
+{
+public:
+
+	static constexpr float TIMEOUT_UNSET = TNumericLimits<float>::Lowest();
+
+	// Number of the latest tile changes kept for incremental consumers.
+	static constexpr int32 CHANGE_LOG_SIZE = 2048;
+
+public:
+
+	// Allocate the grid and precompute the static walls and neighbour masks.
+	void Init(int32 InRows, int32 InColumns);
+
+	// Reset dynamic tile state (types and dangers), static layout is kept.
+	void Reset();
+
+	FORCEINLINE int32 Num() const
+	{
+		return Tiles.Num();
+	}
+
+	FORCEINLINE bool IsValidIndex(FNodeRef NodeRef) const
+	{
+		return Tiles.IsValidIndex(NodeRef);
+	}
+
+	FORCEINLINE int32 GetRows() const
+	{
+		return Rows;
+	}
+
+	FORCEINLINE int32 GetColumns() const
+	{
+		return Columns;
+	}
+
+	FORCEINLINE const FAmGridTile& GetTile(FNodeRef NodeRef) const
+	{
+		return Tiles[NodeRef];
+	}
+
+	FORCEINLINE bool IsWalkable(FNodeRef NodeRef) const
+	{
+		return (Tiles[NodeRef].Flags & EAmGridTileFlags::WALL) == 0;
+	}
+
+	FORCEINLINE int32 GetNeighbourCount(FNodeRef NodeRef) const
+	{
+		return NeighbourCounts[Tiles[NodeRef].NeighbourMask];
+	}
+
+	// Get the NeighbourIndex-th walkable neighbour, NeighbourIndex must be less than GetNeighbourCount.
+	FORCEINLINE FNodeRef GetNeighbour(FNodeRef NodeRef, int32 NeighbourIndex) const
+	{
+		return NodeRef + DirectionOffsets[NeighbourDirections[Tiles[NodeRef].NeighbourMask][NeighbourIndex]];
+	}
+
+	FORCEINLINE uint8 GetNeighbourMask(FNodeRef NodeRef) const
+	{
+		return Tiles[NodeRef].NeighbourMask;
+	}
+
+	FORCEINLINE FNodeRef GetNeighbourInDirection(FNodeRef NodeRef, EAmGridDirection::Type Direction) const
+	{
+		return NodeRef + DirectionOffsets[Direction];
+	}
+
+	FORCEINLINE int32 GetDirectionOffset(EAmGridDirection::Type Direction) const
+	{
+		return DirectionOffsets[Direction];
+	}
+
+	FORCEINLINE ETileType GetType(FNodeRef NodeRef) const
+	{
+		return Tiles[NodeRef].Type;
+	}
+
+	FORCEINLINE int64 GetCost(FNodeRef NodeRef) const
+	{
+		return FAmUtils::GetTileNavCost(Tiles[NodeRef].Type);
+	}
+
+	FORCEINLINE void SetCost(FNodeRef NodeRef, int64 Cost)
+	{
+		ETileType Type = FAmUtils::GetTileType(Cost);
+		if (Tiles[NodeRef].Type != Type)
+		{
+			Tiles[NodeRef].Type = Type;
+			MarkChanged(NodeRef);
+		}
+	}
+
+	// World time relative queries are answered at. Advancing it is not a tile change.
+	FORCEINLINE float GetTime() const
+	{
+		return Time;
+	}
+
+	FORCEINLINE void SetTime(float InTime)
+	{
+		Time = InTime;
+	}
+
+	FORCEINLINE bool HasTimeout(FNodeRef NodeRef) const
+	{
+		return (Tiles[NodeRef].Flags & EAmGridTileFlags::DANGER) != 0;
+	}
+
+	// Time left before the earliest danger interval of the tile starts, negative once it has started.
+	FORCEINLINE float GetTimeout(FNodeRef NodeRef) const
+	{
+		return HasTimeout(NodeRef) ? Tiles[NodeRef].DangerStart - Time : TIMEOUT_UNSET;
+	}
+
+	// True if any tile has danger intervals set.
+	FORCEINLINE bool HasDangers() const
+	{
+		return DangerIntervals.Num() > 0;
+	}
+
+	const FAmGridDangerIntervals& GetDangerIntervals(FNodeRef NodeRef) const;
+
+	// Replace the danger intervals of the tile, an empty list makes the tile safe.
+	void SetDangerIntervals(FNodeRef NodeRef, TArrayView<const FAmGridDangerInterval> Intervals);
+
+	// Check if the tile explodes while we run through it, the times are relative to the grid time.
+	FORCEINLINE bool IsDangerous(FNodeRef NodeRef, float TimeBeforeTileMin, float TimeAfterTileMax) const
+	{
+		const FAmGridTile& Tile = Tiles[NodeRef];
+		if ((Tile.Flags & EAmGridTileFlags::DANGER) == 0 || Time + TimeAfterTileMax < Tile.DangerStart)
+		{
+			return false;
+		}
+
+		return IsDangerousSlow(NodeRef, Time + TimeBeforeTileMin, Time + TimeAfterTileMax);
+	}
+
+	// World time the verdict of IsDangerous with the same relative times may change at, the float max if it never does.
+	float GetDangerChangeTime(FNodeRef NodeRef, float TimeBeforeTileMin, float TimeAfterTileMax) const;
+
+	// World time the last danger interval of the grid ends at, TIMEOUT_UNSET if there are none.
+	float GetLastDangerEnd() const;
+
+	FORCEINLINE uint8 GetOccupantCount(FNodeRef NodeRef) const
+	{
+		return Tiles[NodeRef].Occupants;
+	}
+
+	// Occupants don't affect traversal costs, so they are not recorded in the change log.
+	FORCEINLINE void AddOccupant(FNodeRef NodeRef)
+	{
+		Tiles[NodeRef].Occupants++;
+	}
+
+	FORCEINLINE void RemoveOccupant(FNodeRef NodeRef)
+	{
+		check(Tiles[NodeRef].Occupants > 0);
+		Tiles[NodeRef].Occupants--;
+	}
+
+	// Number of tile changes made so far.
+	FORCEINLINE uint64 GetChangeCount() const
+	{
+		return ChangeCount;
+	}
+
+	/**
+	 * Collect tiles changed since the change count was SinceChangeCount, a tile may be listed several times.
+	 * Returns false if the log has been overwritten since then, every tile has to be treated as changed in that case.
+	 */
+	bool GetChangedTiles(uint64 SinceChangeCount, TArray<FNodeRef>& OutNodeRefs) const;
+
+private:
+
+	bool IsWallLocation(int32 X, int32 Y) const;
+
+	bool IsDangerousSlow(FNodeRef NodeRef, float StartTime, float EndTime) const;
+
+	FORCEINLINE void MarkChanged(FNodeRef NodeRef)
+	{
+		ChangeLog[ChangeCount % CHANGE_LOG_SIZE] = NodeRef;
+		ChangeCount++;
+	}
+
+private:
+
+	// Number of set bits for every neighbour mask.
+	static const int32 NeighbourCounts[1 << EAmGridDirection::MAX];
+
+	// Directions of set bits in ascending order for every neighbour mask.
+	static const uint8 NeighbourDirections[1 << EAmGridDirection::MAX][EAmGridDirection::MAX];
+
+	// NodeRef offset per EAmGridDirection.
+	int32 DirectionOffsets[EAmGridDirection::MAX] = {};
+
+	int32 Rows = 0;
+
+	int32 Columns = 0;
+
+	TArray<FAmGridTile> Tiles;
+
+	// Only tiles with the DANGER flag have an entry, the intervals are sorted by start.
+	TMap<FNodeRef, FAmGridDangerIntervals> DangerIntervals;
+
+	float Time = 0.f;
+
+	// Ring buffer of the latest changed tiles.
+	TArray<FNodeRef> ChangeLog;
+
+	uint64 ChangeCount = 0;
+};
@@ -0,0 +1,114 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridFlowField.h"
+
+#include "AmGridNavMesh.h"
+
+static FORCEINLINE EAmGridDirection::Type GetOpposite(EAmGridDirection::Type Direction)
+{
+	// LEFT/RIGHT and UP/DOWN differ only in the lowest bit.
+	return static_cast<EAmGridDirection::Type>(Direction ^ 1);
+}
+
+void FAmGridFlowField::Build(const FAmGridData& Grid, FNodeRef InTargetNodeRef, float DangerTime)
+{
+	TargetNodeRef = InTargetNodeRef;
+	GridChangeCount = Grid.GetChangeCount();
+	GridTime = Grid.GetTime();
+
+	Costs.Init(TNumericLimits<int64>::Max(), Grid.Num());
+	Directions.Init(EAmGridDirection::MAX, Grid.Num());
+
+	if (!(Grid.IsValidIndex(TargetNodeRef) && Grid.IsWalkable(TargetNodeRef)))
+	{
+		return;
+	}
+
+	auto NodeSorter = [](const FAmGridPathNode& A, const FAmGridPathNode& B)
+	{
+		return A.TraversalCost < B.TraversalCost;
+	};
+
+	OpenList.Reset();
+	OpenList.HeapPush({ TargetNodeRef, 0 }, NodeSorter);
+	Costs[TargetNodeRef] = 0;
+
+	while (OpenList.Num() > 0)
+	{
+		FAmGridPathNode CurrentNode;
+		OpenList.HeapPop(CurrentNode, NodeSorter, false);
+
+		// Skip entries of tiles that have been reached cheaper since they were pushed.
+		if (CurrentNode.TraversalCost > Costs[CurrentNode.NodeRef])
+		{
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesSettled);
+
+		// The search goes backwards, so an agent following the field steps on the current tile, not on the neighbour.
+		int64 TileCost = Grid.GetCost(CurrentNode.NodeRef);
+		if (TileCost >= ETileNavCost::BOMB)
+		{
+			continue;
+		}
+
+		if (Grid.IsDangerous(CurrentNode.NodeRef, 0.f, DangerTime))
+		{
+			TileCost = ETileNavCost::BOMB;
+		}
+
+		const uint8 NeighbourMask = Grid.GetNeighbourMask(CurrentNode.NodeRef);
+		for (uint8 Direction = 0; Direction < EAmGridDirection::MAX; Direction++)
+		{
+			if ((NeighbourMask & (1 << Direction)) == 0)
+			{
+				continue;
+			}
+
+			INC_DWORD_STAT(STAT_Grid_Navigation_NeighboursVisited);
+
+			FNodeRef NeighbourNodeRef = Grid.GetNeighbourInDirection(CurrentNode.NodeRef, static_cast<EAmGridDirection::Type>(Direction));
+			int64 NeighbourTraversalCost = CurrentNode.TraversalCost + TileCost;
+
+			if (NeighbourTraversalCost < Costs[NeighbourNodeRef])
+			{
+				Costs[NeighbourNodeRef] = NeighbourTraversalCost;
+				Directions[NeighbourNodeRef] = GetOpposite(static_cast<EAmGridDirection::Type>(Direction));
+				OpenList.HeapPush({ NeighbourNodeRef, NeighbourTraversalCost }, NodeSorter);
+			}
+		}
+	}
+}
+
+EGraphAStarResult FAmGridFlowField::FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, TArray<FAmGridPathNode>& OutPath) const
+{
+	OutPath.Reset();
+
+	if (!(Grid.IsValidIndex(StartNodeRef) && Grid.IsWalkable(StartNodeRef) && Grid.IsValidIndex(TargetNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	if (!IsReachable(StartNodeRef))
+	{
+		return GoalUnreachable;
+	}
+
+	// Costs are measured from the target, the cost accumulated along the path is what is left behind.
+	const int64 StartCost = Costs[StartNodeRef];
+
+	FNodeRef NodeRef = StartNodeRef;
+	while (NodeRef != TargetNodeRef)
+	{
+		if (OutPath.Num() >= Grid.Num())
+		{
+			return InfiniteLoop;
+		}
+
+		NodeRef = Grid.GetNeighbourInDirection(NodeRef, Directions[NodeRef]);
+		OutPath.Add({ NodeRef, StartCost - Costs[NodeRef] });
+	}
+
+	return SearchSuccess;
+}
@@ -0,0 +1,80 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+/**
+ * FAmGridFlowField stores the direction of the cheapest move towards a single target for every tile of the grid.
+ * It is built by one Dijkstra search outwards from the target, so any number of agents chasing the same target
+ * share one search and then only follow the directions.
+ * Tile costs have the same BLOCK/BOMB semantics as FAmGridAStar, bombs can't be passed
+ * and tiles that explode sooner than the danger time cost as much as bombs.
+ */
+class FAmGridFlowField
+{
+public:
+
+	/**
+	 * Build the field towards TargetNodeRef.
+	 * The field has to be rebuilt once the grid changes, or once the grid time moves on while there are dangers on the grid.
+	 * GetGridChangeCount and GetGridTime tell the grid state it was built for.
+	 */
+	void Build(const FAmGridData& Grid, FNodeRef TargetNodeRef, float DangerTime);
+
+	FORCEINLINE FNodeRef GetTarget() const
+	{
+		return TargetNodeRef;
+	}
+
+	FORCEINLINE uint64 GetGridChangeCount() const
+	{
+		return GridChangeCount;
+	}
+
+	// Grid time the field was built at, dangers are seen relative to it.
+	FORCEINLINE float GetGridTime() const
+	{
+		return GridTime;
+	}
+
+	FORCEINLINE bool IsReachable(FNodeRef NodeRef) const
+	{
+		return Costs.IsValidIndex(NodeRef) && Costs[NodeRef] != TNumericLimits<int64>::Max();
+	}
+
+	// Cost of the path from the tile to the target.
+	FORCEINLINE int64 GetTraversalCost(FNodeRef NodeRef) const
+	{
+		return Costs[NodeRef];
+	}
+
+	// Direction of the next move from the tile, MAX for the target and unreachable tiles.
+	FORCEINLINE EAmGridDirection::Type GetDirection(FNodeRef NodeRef) const
+	{
+		return Directions[NodeRef];
+	}
+
+	/**
+	 * Follow the field from StartNodeRef to the target.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 */
+	EGraphAStarResult FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, TArray<FAmGridPathNode>& OutPath) const;
+
+private:
+
+	FNodeRef TargetNodeRef = INDEX_NONE;
+
+	uint64 GridChangeCount = 0;
+
+	float GridTime = 0.f;
+
+	TArray<int64> Costs;
+
+	TArray<EAmGridDirection::Type> Directions;
+
+	// Kept between builds, so rebuilding the field doesn't allocate.
+	TArray<FAmGridPathNode> OpenList;
+};
@@ -0,0 +1,454 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridHierarchy.h"
+
+#include "AmGridNavMesh.h"
+#include "AmGridQueryFilter.h"
+
+static FORCEINLINE bool SortByCost(const FAmGridPathNode& A, const FAmGridPathNode& B)
+{
+	return A.TraversalCost < B.TraversalCost;
+}
+
+void FAmGridHierarchy::Init(const FAmGridData& Grid, int32 InClusterSize)
+{
+	Rows = Grid.GetRows();
+	Columns = Grid.GetColumns();
+	ClusterSize = FMath::Max(InClusterSize, 2);
+	ClustersX = FMath::DivideAndRoundUp(Columns, ClusterSize);
+	ClustersY = FMath::DivideAndRoundUp(Rows, ClusterSize);
+
+	Clusters.Reset();
+	Nodes.Reset();
+
+	for (int32 ClusterY = 0; ClusterY < ClustersY; ClusterY++)
+	{
+		for (int32 ClusterX = 0; ClusterX < ClustersX; ClusterX++)
+		{
+			FCluster& Cluster = Clusters.AddDefaulted_GetRef();
+			Cluster.MinX = ClusterX * ClusterSize;
+			Cluster.MinY = ClusterY * ClusterSize;
+			Cluster.SizeX = FMath::Min(ClusterSize, Columns - Cluster.MinX);
+			Cluster.SizeY = FMath::Min(ClusterSize, Rows - Cluster.MinY);
+			Cluster.bIsDirty = true;
+		}
+	}
+
+	// Borders between horizontally adjacent clusters.
+	for (int32 ClusterX = 1; ClusterX < ClustersX; ClusterX++)
+	{
+		const int32 X = ClusterX * ClusterSize;
+		for (int32 ClusterY = 0; ClusterY < ClustersY; ClusterY++)
+		{
+			AddTransitions(Grid, X - 1, X, ClusterY * ClusterSize, FMath::Min((ClusterY + 1) * ClusterSize, Rows), true);
+		}
+	}
+
+	// Borders between vertically adjacent clusters.
+	for (int32 ClusterY = 1; ClusterY < ClustersY; ClusterY++)
+	{
+		const int32 Y = ClusterY * ClusterSize;
+		for (int32 ClusterX = 0; ClusterX < ClustersX; ClusterX++)
+		{
+			AddTransitions(Grid, Y - 1, Y, ClusterX * ClusterSize, FMath::Min((ClusterX + 1) * ClusterSize, Columns), false);
+		}
+	}
+
+	TileTypes.SetNumUninitialized(Grid.Num());
+	for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+	{
+		TileTypes[NodeRef] = Grid.GetType(NodeRef);
+	}
+
+	GridChangeCount = Grid.GetChangeCount();
+
+	for (FCluster& Cluster : Clusters)
+	{
+		BuildCluster(Grid, Cluster);
+	}
+}
+
+void FAmGridHierarchy::Update(const FAmGridData& Grid, int32 InClusterSize)
+{
+	if (Rows != Grid.GetRows() || Columns != Grid.GetColumns() || ClusterSize != FMath::Max(InClusterSize, 2))
+	{
+		Init(Grid, InClusterSize);
+		return;
+	}
+
+	if (GridChangeCount == Grid.GetChangeCount())
+	{
+		return;
+	}
+
+	// Dangers are logged too, only a change of the tile type affects the cluster costs.
+	auto UpdateTileType = [this, &Grid](FNodeRef NodeRef)
+	{
+		if (TileTypes[NodeRef] != Grid.GetType(NodeRef))
+		{
+			TileTypes[NodeRef] = Grid.GetType(NodeRef);
+			Clusters[GetClusterIndex(NodeRef)].bIsDirty = true;
+		}
+	};
+
+	if (Grid.GetChangedTiles(GridChangeCount, ChangedTiles))
+	{
+		for (FNodeRef NodeRef : ChangedTiles)
+		{
+			UpdateTileType(NodeRef);
+		}
+	}
+	else
+	{
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			UpdateTileType(NodeRef);
+		}
+	}
+
+	GridChangeCount = Grid.GetChangeCount();
+
+	for (FCluster& Cluster : Clusters)
+	{
+		if (Cluster.bIsDirty)
+		{
+			BuildCluster(Grid, Cluster);
+		}
+	}
+}
+
+bool FAmGridHierarchy::IsLongRange(FNodeRef StartNodeRef, FNodeRef EndNodeRef) const
+{
+	if (Clusters.Num() == 0 || GetClusterIndex(StartNodeRef) == GetClusterIndex(EndNodeRef))
+	{
+		return false;
+	}
+
+	return GetManhattanCost(StartNodeRef, EndNodeRef) >= ClusterSize * ETileNavCost::DEFAULT;
+}
+
+EGraphAStarResult FAmGridHierarchy::FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& Filter, TArray<FAmGridPathNode>& OutPath, FSearchStats& OutStats)
+{
+	OutPath.Reset();
+	OutStats = FSearchStats();
+
+	if (!(Grid.IsValidIndex(StartNodeRef) && Grid.IsWalkable(StartNodeRef) && Grid.IsValidIndex(EndNodeRef) && Grid.IsWalkable(EndNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	const FCluster& StartCluster = Clusters[GetClusterIndex(StartNodeRef)];
+	const FCluster& GoalCluster = Clusters[GetClusterIndex(EndNodeRef)];
+
+	// The goal is an extra abstract node past the regular ones.
+	const int32 GoalIndex = Nodes.Num();
+
+	AbstractCosts.Init(TNumericLimits<int64>::Max(), Nodes.Num() + 1);
+	AbstractParents.Init(INDEX_NONE, Nodes.Num() + 1);
+	AbstractOpenList.Reset();
+
+	// Open list entries hold abstract node indices and their total costs.
+	auto Relax = [this, EndNodeRef, GoalIndex](int32 ParentIndex, int32 NodeIndex, int64 TraversalCost)
+	{
+		if (TraversalCost < AbstractCosts[NodeIndex])
+		{
+			AbstractCosts[NodeIndex] = TraversalCost;
+			AbstractParents[NodeIndex] = ParentIndex;
+
+			int64 HeuristicCost = NodeIndex == GoalIndex ? 0 : GetManhattanCost(Nodes[NodeIndex].NodeRef, EndNodeRef);
+			AbstractOpenList.HeapPush({ NodeIndex, TraversalCost + HeuristicCost }, SortByCost);
+		}
+	};
+
+	// Costs of reaching the goal from the entrances of its cluster.
+	OutStats.LocalNodesExpanded += SearchCluster(Grid, GoalCluster, EndNodeRef, 0, nullptr, true);
+	GoalCosts.SetNumUninitialized(GoalCluster.Entrances.Num());
+	for (int32 EntranceIndex = 0; EntranceIndex < GoalCluster.Entrances.Num(); EntranceIndex++)
+	{
+		GoalCosts[EntranceIndex] = LocalCosts[GetLocalIndex(GoalCluster, Nodes[GoalCluster.Entrances[EntranceIndex]].NodeRef)];
+	}
+
+	// Costs of reaching the entrances of the start cluster.
+	OutStats.LocalNodesExpanded += SearchCluster(Grid, StartCluster, StartNodeRef, 0, nullptr, false);
+	for (int32 NodeIndex : StartCluster.Entrances)
+	{
+		int64 TraversalCost = LocalCosts[GetLocalIndex(StartCluster, Nodes[NodeIndex].NodeRef)];
+		if (TraversalCost != TNumericLimits<int64>::Max())
+		{
+			Relax(INDEX_NONE, NodeIndex, TraversalCost);
+		}
+	}
+
+	while (AbstractOpenList.Num() > 0)
+	{
+		FAmGridPathNode CurrentNode;
+		AbstractOpenList.HeapPop(CurrentNode, SortByCost, false);
+
+		const int32 NodeIndex = CurrentNode.NodeRef;
+		if (NodeIndex == GoalIndex)
+		{
+			break;
+		}
+
+		const FAbstractNode& Node = Nodes[NodeIndex];
+		const int64 TraversalCost = AbstractCosts[NodeIndex];
+
+		// Skip entries of nodes that have been reached cheaper since they were pushed.
+		if (CurrentNode.TraversalCost > TraversalCost + GetManhattanCost(Node.NodeRef, EndNodeRef))
+		{
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_AbstractNodesExpanded);
+		OutStats.AbstractNodesExpanded++;
+
+		const FCluster& Cluster = Clusters[Node.ClusterIndex];
+		const int32 NumEntrances = Cluster.Entrances.Num();
+
+		if (&Cluster == &GoalCluster && GoalCosts[Node.EntranceIndex] != TNumericLimits<int64>::Max())
+		{
+			Relax(NodeIndex, GoalIndex, TraversalCost + GoalCosts[Node.EntranceIndex]);
+		}
+
+		// Cross the cluster border.
+		int64 PeerCost = Grid.GetCost(Nodes[Node.PeerIndex].NodeRef);
+		if (PeerCost < ETileNavCost::BOMB)
+		{
+			Relax(NodeIndex, Node.PeerIndex, TraversalCost + PeerCost);
+		}
+
+		// Move to another entrance of the same cluster.
+		for (int32 EntranceIndex = 0; EntranceIndex < NumEntrances; EntranceIndex++)
+		{
+			int64 EntranceCost = Cluster.EntranceCosts[Node.EntranceIndex * NumEntrances + EntranceIndex];
+			if (EntranceIndex != Node.EntranceIndex && EntranceCost != TNumericLimits<int64>::Max())
+			{
+				Relax(NodeIndex, Cluster.Entrances[EntranceIndex], TraversalCost + EntranceCost);
+			}
+		}
+	}
+
+	if (AbstractParents[GoalIndex] == INDEX_NONE)
+	{
+		return GoalUnreachable;
+	}
+
+	TArray<int32, TInlineAllocator<64>> AbstractPath;
+	for (int32 NodeIndex = AbstractParents[GoalIndex]; NodeIndex != INDEX_NONE; NodeIndex = AbstractParents[NodeIndex])
+	{
+		AbstractPath.Add(NodeIndex);
+	}
+
+	/* Refine the abstract path into tiles. */
+
+	FNodeRef CurrentNodeRef = StartNodeRef;
+	int64 CurrentCost = 0;
+
+	auto RefineInCluster = [&](const FCluster& Cluster, FNodeRef TargetNodeRef) -> bool
+	{
+		if (TargetNodeRef == CurrentNodeRef)
+		{
+			return true;
+		}
+
+		OutStats.LocalNodesExpanded += SearchCluster(Grid, Cluster, CurrentNodeRef, CurrentCost, &Filter, false);
+
+		if (LocalCosts[GetLocalIndex(Cluster, TargetNodeRef)] == TNumericLimits<int64>::Max())
+		{
+			return false;
+		}
+
+		const int32 FirstIndex = OutPath.Num();
+		for (FNodeRef NodeRef = TargetNodeRef; NodeRef != CurrentNodeRef; NodeRef = LocalParents[GetLocalIndex(Cluster, NodeRef)])
+		{
+			OutPath.Add({ NodeRef, LocalCosts[GetLocalIndex(Cluster, NodeRef)] });
+		}
+
+		for (int32 Index = FirstIndex, LastIndex = OutPath.Num() - 1; Index < LastIndex; Index++, LastIndex--)
+		{
+			OutPath.Swap(Index, LastIndex);
+		}
+
+		CurrentNodeRef = TargetNodeRef;
+		CurrentCost = OutPath.Last().TraversalCost;
+		return true;
+	};
+
+	int32 PreviousIndex = INDEX_NONE;
+	for (int32 PathIndex = AbstractPath.Num() - 1; PathIndex >= 0; PathIndex--)
+	{
+		const int32 NodeIndex = AbstractPath[PathIndex];
+		const FAbstractNode& Node = Nodes[NodeIndex];
+
+		if (PreviousIndex != INDEX_NONE && Nodes[PreviousIndex].PeerIndex == NodeIndex)
+		{
+			if (!Filter.IsTraversalAllowed(CurrentNodeRef, Node.NodeRef))
+			{
+				return SearchFail;
+			}
+
+			CurrentCost += Filter.GetNodeTraversalCost(CurrentCost, Node.NodeRef);
+			CurrentNodeRef = Node.NodeRef;
+			OutPath.Add({ CurrentNodeRef, CurrentCost });
+		}
+		else if (!RefineInCluster(Clusters[Node.ClusterIndex], Node.NodeRef))
+		{
+			return SearchFail;
+		}
+
+		PreviousIndex = NodeIndex;
+	}
+
+	if (!RefineInCluster(GoalCluster, EndNodeRef))
+	{
+		return SearchFail;
+	}
+
+	return SearchSuccess;
+}
+
+void FAmGridHierarchy::AddTransitions(const FAmGridData& Grid, int32 FixedA, int32 FixedB, int32 RunMin, int32 RunMax, bool bVertical)
+{
+	auto GetNodeRef = [this, bVertical](int32 Fixed, int32 Run) -> FNodeRef
+	{
+		return bVertical ? Run * Columns + Fixed : Fixed * Columns + Run;
+	};
+
+	auto AddNode = [this](FNodeRef NodeRef, int32 PeerIndex)
+	{
+		FAbstractNode& Node = Nodes.AddDefaulted_GetRef();
+		Node.NodeRef = NodeRef;
+		Node.ClusterIndex = GetClusterIndex(NodeRef);
+		Node.EntranceIndex = Clusters[Node.ClusterIndex].Entrances.Add(Nodes.Num() - 1);
+		Node.PeerIndex = PeerIndex;
+	};
+
+	int32 RunStart = INDEX_NONE;
+	for (int32 Run = RunMin; Run <= RunMax; Run++)
+	{
+		const bool bIsOpen = Run < RunMax && Grid.IsWalkable(GetNodeRef(FixedA, Run)) && Grid.IsWalkable(GetNodeRef(FixedB, Run));
+
+		if (bIsOpen && RunStart == INDEX_NONE)
+		{
+			RunStart = Run;
+		}
+		else if (!bIsOpen && RunStart != INDEX_NONE)
+		{
+			// One transition in the middle of every open run.
+			const int32 Middle = (RunStart + Run - 1) / 2;
+			const int32 FirstIndex = Nodes.Num();
+			AddNode(GetNodeRef(FixedA, Middle), FirstIndex + 1);
+			AddNode(GetNodeRef(FixedB, Middle), FirstIndex);
+			RunStart = INDEX_NONE;
+		}
+	}
+}
+
+void FAmGridHierarchy::BuildCluster(const FAmGridData& Grid, FCluster& Cluster)
+{
+	const int32 NumEntrances = Cluster.Entrances.Num();
+	Cluster.EntranceCosts.Init(TNumericLimits<int64>::Max(), NumEntrances * NumEntrances);
+
+	for (int32 FromIndex = 0; FromIndex < NumEntrances; FromIndex++)
+	{
+		SearchCluster(Grid, Cluster, Nodes[Cluster.Entrances[FromIndex]].NodeRef, 0, nullptr, false);
+
+		for (int32 ToIndex = 0; ToIndex < NumEntrances; ToIndex++)
+		{
+			Cluster.EntranceCosts[FromIndex * NumEntrances + ToIndex] = LocalCosts[GetLocalIndex(Cluster, Nodes[Cluster.Entrances[ToIndex]].NodeRef)];
+		}
+	}
+
+	Cluster.bIsDirty = false;
+}
+
+int32 FAmGridHierarchy::SearchCluster(const FAmGridData& Grid, const FCluster& Cluster, FNodeRef StartNodeRef, int64 StartCost, const FAmGridQueryFilter* Filter, bool bBackwards)
+{
+	const int32 NumLocalNodes = Cluster.SizeX * Cluster.SizeY;
+	LocalCosts.Init(TNumericLimits<int64>::Max(), NumLocalNodes);
+	LocalParents.Init(INDEX_NONE, NumLocalNodes);
+	LocalOpenList.Reset();
+
+	LocalCosts[GetLocalIndex(Cluster, StartNodeRef)] = StartCost;
+	LocalOpenList.HeapPush({ StartNodeRef, StartCost }, SortByCost);
+
+	int32 NodesExpanded = 0;
+
+	while (LocalOpenList.Num() > 0)
+	{
+		FAmGridPathNode CurrentNode;
+		LocalOpenList.HeapPop(CurrentNode, SortByCost, false);
+
+		// Skip entries of tiles that have been reached cheaper since they were pushed.
+		if (CurrentNode.TraversalCost > LocalCosts[GetLocalIndex(Cluster, CurrentNode.NodeRef)])
+		{
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+		NodesExpanded++;
+
+		int64 LeaveCost = 0;
+		if (bBackwards)
+		{
+			LeaveCost = Grid.GetCost(CurrentNode.NodeRef);
+			if (LeaveCost >= ETileNavCost::BOMB)
+			{
+				continue;
+			}
+		}
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(CurrentNode.NodeRef);
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			FNodeRef NeighbourNodeRef = Grid.GetNeighbour(CurrentNode.NodeRef, NeighbourIdx);
+			if (!IsInCluster(Cluster, NeighbourNodeRef))
+			{
+				continue;
+			}
+
+			INC_DWORD_STAT(STAT_Grid_Navigation_NeighboursVisited);
+
+			int64 StepCost;
+			if (bBackwards)
+			{
+				StepCost = LeaveCost;
+			}
+			else if (Filter)
+			{
+				if (!Filter->IsTraversalAllowed(CurrentNode.NodeRef, NeighbourNodeRef))
+				{
+					continue;
+				}
+				StepCost = Filter->GetNodeTraversalCost(CurrentNode.TraversalCost, NeighbourNodeRef);
+			}
+			else
+			{
+				StepCost = Grid.GetCost(NeighbourNodeRef);
+				if (StepCost >= ETileNavCost::BOMB)
+				{
+					continue;
+				}
+			}
+
+			const int32 NeighbourLocalIndex = GetLocalIndex(Cluster, NeighbourNodeRef);
+			const int64 NeighbourTraversalCost = CurrentNode.TraversalCost + StepCost;
+
+			if (NeighbourTraversalCost < LocalCosts[NeighbourLocalIndex])
+			{
+				LocalCosts[NeighbourLocalIndex] = NeighbourTraversalCost;
+				LocalParents[NeighbourLocalIndex] = CurrentNode.NodeRef;
+				LocalOpenList.HeapPush({ NeighbourNodeRef, NeighbourTraversalCost }, SortByCost);
+			}
+		}
+	}
+
+	return NodesExpanded;
+}
+
+int64 FAmGridHierarchy::GetManhattanCost(FNodeRef NodeRefA, FNodeRef NodeRefB) const
+{
+	const int32 DeltaX = FMath::Abs(NodeRefA % Columns - NodeRefB % Columns);
+	const int32 DeltaY = FMath::Abs(NodeRefA / Columns - NodeRefB / Columns);
+	return int64(DeltaX + DeltaY) * ETileNavCost::DEFAULT;
+}
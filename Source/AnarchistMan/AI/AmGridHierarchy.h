@@ -0,0 +1,144 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+class FAmGridQueryFilter;
+
+/**
+ * FAmGridHierarchy is an abstraction layer over the grid for long range queries (HPA*).
+ * The grid is split into square clusters. Every run of walkable tiles along a cluster border gets one transition,
+ * the tiles of a transition become abstract nodes linked to each other and to every other abstract node of their cluster
+ * with the precomputed cost of the cheapest path inside the cluster.
+ * A query searches the abstract graph first, then refines every abstract edge with a search local to its cluster.
+ * Clusters are rebuilt only when the type of one of their tiles changes.
+ */
+class FAmGridHierarchy
+{
+	struct FCluster
+	{
+		int32 MinX;
+		int32 MinY;
+		int32 SizeX;
+		int32 SizeY;
+
+		// Abstract nodes in the cluster.
+		TArray<int32> Entrances;
+
+		// Cheapest in-cluster cost between every pair of entrances, Entrances.Num() squared.
+		TArray<int64> EntranceCosts;
+
+		bool bIsDirty;
+	};
+
+	struct FAbstractNode
+	{
+		FNodeRef NodeRef;
+		int32 ClusterIndex;
+		// Index in the Entrances of the cluster.
+		int32 EntranceIndex;
+		// Abstract node on the other side of the cluster border.
+		int32 PeerIndex;
+	};
+
+public:
+
+	struct FSearchStats
+	{
+		int32 AbstractNodesExpanded = 0;
+		int32 LocalNodesExpanded = 0;
+	};
+
+public:
+
+	// Split the grid into clusters of ClusterSize tiles per side and build the abstract graph.
+	void Init(const FAmGridData& Grid, int32 ClusterSize);
+
+	// Rebuild the clusters with tiles that changed type since the last update, initialize the hierarchy if the grid or cluster size changed.
+	void Update(const FAmGridData& Grid, int32 ClusterSize);
+
+	// Check if a query is worth going through the abstract graph, nearby tiles are better left to the flat search.
+	bool IsLongRange(FNodeRef StartNodeRef, FNodeRef EndNodeRef) const;
+
+	/**
+	 * Find a path from StartNodeRef to EndNodeRef, the tiles must lie in different clusters.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 * The abstract search uses static tile costs, refinement uses the query filter, so explosions are still avoided locally.
+	 */
+	EGraphAStarResult FindPath(const FAmGridData& Grid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& Filter, TArray<FAmGridPathNode>& OutPath, FSearchStats& OutStats);
+
+private:
+
+	void AddTransitions(const FAmGridData& Grid, int32 FixedA, int32 FixedB, int32 RunMin, int32 RunMax, bool bVertical);
+
+	void BuildCluster(const FAmGridData& Grid, FCluster& Cluster);
+
+	FORCEINLINE int32 GetClusterIndex(FNodeRef NodeRef) const
+	{
+		return (NodeRef / Columns / ClusterSize) * ClustersX + (NodeRef % Columns) / ClusterSize;
+	}
+
+	FORCEINLINE int32 GetLocalIndex(const FCluster& Cluster, FNodeRef NodeRef) const
+	{
+		return (NodeRef / Columns - Cluster.MinY) * Cluster.SizeX + (NodeRef % Columns - Cluster.MinX);
+	}
+
+	FORCEINLINE bool IsInCluster(const FCluster& Cluster, FNodeRef NodeRef) const
+	{
+		const int32 X = NodeRef % Columns;
+		const int32 Y = NodeRef / Columns;
+		return X >= Cluster.MinX && X < Cluster.MinX + Cluster.SizeX && Y >= Cluster.MinY && Y < Cluster.MinY + Cluster.SizeY;
+	}
+
+	/**
+	 * Dijkstra restricted to the cluster, fills LocalCosts and LocalParents.
+	 * Static tile costs are used without a filter. Backwards searches pay for the tile they leave,
+	 * so LocalCosts hold the cost of reaching StartNodeRef from every tile instead.
+	 */
+	int32 SearchCluster(const FAmGridData& Grid, const FCluster& Cluster, FNodeRef StartNodeRef, int64 StartCost, const FAmGridQueryFilter* Filter, bool bBackwards);
+
+	int64 GetManhattanCost(FNodeRef NodeRefA, FNodeRef NodeRefB) const;
+
+private:
+
+	int32 Rows = 0;
+
+	int32 Columns = 0;
+
+	int32 ClusterSize = 0;
+
+	int32 ClustersX = 0;
+
+	int32 ClustersY = 0;
+
+	uint64 GridChangeCount = 0;
+
+	TArray<FCluster> Clusters;
+
+	TArray<FAbstractNode> Nodes;
+
+	// Tile types the clusters were built for.
+	TArray<ETileType> TileTypes;
+
+	/* Scratch buffers reused between queries. */
+
+	TArray<FNodeRef> ChangedTiles;
+
+	TArray<int64> LocalCosts;
+
+	TArray<FNodeRef> LocalParents;
+
+	TArray<FAmGridPathNode> LocalOpenList;
+
+	TArray<int64> AbstractCosts;
+
+	TArray<int32> AbstractParents;
+
+	TArray<FAmGridPathNode> AbstractOpenList;
+
+	// Cost from every entrance of the goal cluster to the goal.
+	TArray<int64> GoalCosts;
+};
@@ -0,0 +1,313 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridIncrementalSearch.h"
+
+#include "Algo/Reverse.h"
+
+#include "AmGridNavMesh.h"
+#include "AmGridQueryFilter.h"
+
+FAmGridIncrementalSearch::FAmGridIncrementalSearch(const FAmGridData& InGrid) :
+	Grid(InGrid), Filter(nullptr), StartNodeRef(INDEX_NONE), EndNodeRef(INDEX_NONE), SpeedMultiplier(0.f), ChangeCount(0), DangerChangeTime(0.f), HeuristicVersion(0)
+{
+}
+
+EGraphAStarResult FAmGridIncrementalSearch::FindPath(FNodeRef InStartNodeRef, FNodeRef InEndNodeRef, const FAmGridQueryFilter& QueryFilter, TArray<FAmGridPathNode>& OutPath)
+{
+	if (!(Grid.IsValidIndex(InStartNodeRef) && Grid.IsWalkable(InStartNodeRef) && Grid.IsValidIndex(InEndNodeRef) && Grid.IsWalkable(InEndNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	if (InStartNodeRef == InEndNodeRef)
+	{
+		return SearchSuccess;
+	}
+
+	Filter = &QueryFilter;
+
+	// Danger costs depend on the time the tiles are entered at, the search carries over until one of them may change.
+	const bool bSameTime = Grid.GetTime() < DangerChangeTime;
+	const bool bSameRoot = InStartNodeRef == StartNodeRef && QueryFilter.GetSpeedMultiplier() == SpeedMultiplier && TraversalCosts.Num() == Grid.Num() && bSameTime;
+	if (!bSameRoot || !ApplyChangedTiles())
+	{
+		SpeedMultiplier = QueryFilter.GetSpeedMultiplier();
+		EndNodeRef = InEndNodeRef;
+		HeuristicVersion = QueryFilter.GetHeuristicVersion();
+		Reinitialize(InStartNodeRef);
+	}
+	else if (InEndNodeRef != EndNodeRef || QueryFilter.GetHeuristicVersion() != HeuristicVersion)
+	{
+		EndNodeRef = InEndNodeRef;
+		HeuristicVersion = QueryFilter.GetHeuristicVersion();
+		UpdateKeys();
+	}
+
+	ComputeShortestPath();
+
+	EGraphAStarResult Result = SearchSuccess;
+	FNodeRef BestNodeRef = EndNodeRef;
+
+	if (TraversalCosts[EndNodeRef] == COST_INFINITE)
+	{
+		Result = GoalUnreachable;
+
+		// The open list is exhausted, so every reachable tile is final, pick the one closest to the goal.
+		double BestHeuristicCost = GetHeuristicCost(StartNodeRef);
+		BestNodeRef = StartNodeRef;
+
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			if (TraversalCosts[NodeRef] != COST_INFINITE)
+			{
+				double HeuristicCost = GetHeuristicCost(NodeRef);
+				if (HeuristicCost < BestHeuristicCost)
+				{
+					BestHeuristicCost = HeuristicCost;
+					BestNodeRef = NodeRef;
+				}
+			}
+		}
+	}
+
+	// No point to waste perf creating the path if querier doesn't want it.
+	if (Result == SearchSuccess || Filter->WantsPartialSolution())
+	{
+		StorePath(BestNodeRef, OutPath);
+	}
+
+	Filter = nullptr;
+
+	return Result;
+}
+
+void FAmGridIncrementalSearch::Reinitialize(FNodeRef InStartNodeRef)
+{
+	StartNodeRef = InStartNodeRef;
+	ChangeCount = Grid.GetChangeCount();
+	DangerChangeTime = TNumericLimits<float>::Max();
+
+	TraversalCosts.Init(COST_INFINITE, Grid.Num());
+	LookaheadCosts.Init(COST_INFINITE, Grid.Num());
+	Parents.Init(INDEX_NONE, Grid.Num());
+	Keys.SetNumUninitialized(Grid.Num());
+	HeapIndices.Init(INDEX_NONE, Grid.Num());
+	Heap.Reset();
+
+	LookaheadCosts[StartNodeRef] = 0;
+	HeapInsert(StartNodeRef);
+}
+
+bool FAmGridIncrementalSearch::ApplyChangedTiles()
+{
+	if (!Grid.GetChangedTiles(ChangeCount, ChangedTiles))
+	{
+		return false;
+	}
+
+	ChangeCount = Grid.GetChangeCount();
+
+	// A tile change only affects the cost of entering that tile, so the tile itself is the only one to update.
+	for (FNodeRef NodeRef : ChangedTiles)
+	{
+		if (Grid.IsWalkable(NodeRef))
+		{
+			UpdateNode(NodeRef);
+		}
+	}
+
+	return true;
+}
+
+void FAmGridIncrementalSearch::UpdateKeys()
+{
+	for (FNodeRef NodeRef : Heap)
+	{
+		Keys[NodeRef] = CalculateKey(NodeRef);
+	}
+
+	for (int32 Index = Heap.Num() / 2 - 1; Index >= 0; Index--)
+	{
+		HeapSiftDown(Index);
+	}
+}
+
+void FAmGridIncrementalSearch::UpdateNode(FNodeRef NodeRef)
+{
+	if (NodeRef != StartNodeRef)
+	{
+		int64 BestCost = COST_INFINITE;
+		FNodeRef BestParent = INDEX_NONE;
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+		for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+		{
+			FNodeRef NeighbourRef = Grid.GetNeighbour(NodeRef, NeighbourIndex);
+
+			const int64 NeighbourCost = TraversalCosts[NeighbourRef];
+			if (NeighbourCost == COST_INFINITE || !Filter->IsTraversalAllowed(NeighbourRef, NodeRef))
+			{
+				continue;
+			}
+
+			int64 Cost = NeighbourCost + Filter->GetNodeTraversalCost(NeighbourCost, NodeRef);
+			DangerChangeTime = FMath::Min(DangerChangeTime, Filter->GetNodeDangerChangeTime(NeighbourCost, NodeRef));
+
+			if (Cost < BestCost)
+			{
+				BestCost = Cost;
+				BestParent = NeighbourRef;
+			}
+		}
+
+		LookaheadCosts[NodeRef] = BestCost;
+		Parents[NodeRef] = BestParent;
+	}
+
+	if (HeapIndices[NodeRef] != INDEX_NONE)
+	{
+		HeapRemove(NodeRef);
+	}
+
+	if (TraversalCosts[NodeRef] != LookaheadCosts[NodeRef])
+	{
+		HeapInsert(NodeRef);
+	}
+}
+
+void FAmGridIncrementalSearch::ComputeShortestPath()
+{
+	while (Heap.Num() > 0 && (Keys[Heap[0]] < CalculateKey(EndNodeRef) || TraversalCosts[EndNodeRef] != LookaheadCosts[EndNodeRef]))
+	{
+		FNodeRef NodeRef = HeapPop();
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+
+		if (TraversalCosts[NodeRef] > LookaheadCosts[NodeRef])
+		{
+			TraversalCosts[NodeRef] = LookaheadCosts[NodeRef];
+		}
+		else
+		{
+			TraversalCosts[NodeRef] = COST_INFINITE;
+			UpdateNode(NodeRef);
+		}
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+		for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+		{
+			UpdateNode(Grid.GetNeighbour(NodeRef, NeighbourIndex));
+		}
+	}
+}
+
+FAmGridIncrementalSearch::FSearchKey FAmGridIncrementalSearch::CalculateKey(FNodeRef NodeRef) const
+{
+	const int64 Cost = FMath::Min(TraversalCosts[NodeRef], LookaheadCosts[NodeRef]);
+	if (Cost == COST_INFINITE)
+	{
+		return { TNumericLimits<double>::Max(), COST_INFINITE };
+	}
+
+	return { double(Cost) + GetHeuristicCost(NodeRef), Cost };
+}
+
+double FAmGridIncrementalSearch::GetHeuristicCost(FNodeRef NodeRef) const
+{
+	return Filter->GetHeuristicCost(NodeRef, EndNodeRef) * Filter->GetHeuristicScale();
+}
+
+void FAmGridIncrementalSearch::StorePath(FNodeRef NodeRef, TArray<FAmGridPathNode>& OutPath) const
+{
+	OutPath.Reset();
+
+	// Every tile on the path is consistent, so the parents form a tree rooted at the start tile.
+	for (FNodeRef CurrentRef = NodeRef; CurrentRef != StartNodeRef && CurrentRef != INDEX_NONE; CurrentRef = Parents[CurrentRef])
+	{
+		if (!ensure(OutPath.Num() < Grid.Num()))
+		{
+			break;
+		}
+
+		OutPath.Add({ CurrentRef, TraversalCosts[CurrentRef] });
+	}
+
+	Algo::Reverse(OutPath);
+}
+
+void FAmGridIncrementalSearch::HeapInsert(FNodeRef NodeRef)
+{
+	Keys[NodeRef] = CalculateKey(NodeRef);
+
+	int32 Index = Heap.Add(NodeRef);
+	HeapIndices[NodeRef] = Index;
+	HeapSiftUp(Index);
+}
+
+void FAmGridIncrementalSearch::HeapRemove(FNodeRef NodeRef)
+{
+	int32 Index = HeapIndices[NodeRef];
+	HeapIndices[NodeRef] = INDEX_NONE;
+
+	FNodeRef LastNodeRef = Heap.Pop(false);
+	if (Index < Heap.Num())
+	{
+		HeapSet(Index, LastNodeRef);
+		HeapSiftUp(Index);
+		HeapSiftDown(HeapIndices[LastNodeRef]);
+	}
+}
+
+FNodeRef FAmGridIncrementalSearch::HeapPop()
+{
+	FNodeRef NodeRef = Heap[0];
+	HeapRemove(NodeRef);
+	return NodeRef;
+}
+
+void FAmGridIncrementalSearch::HeapSiftUp(int32 Index)
+{
+	FNodeRef NodeRef = Heap[Index];
+
+	while (Index > 0)
+	{
+		int32 ParentIndex = (Index - 1) / 2;
+		if (!(Keys[NodeRef] < Keys[Heap[ParentIndex]]))
+		{
+			break;
+		}
+
+		HeapSet(Index, Heap[ParentIndex]);
+		Index = ParentIndex;
+	}
+
+	HeapSet(Index, NodeRef);
+}
+
+void FAmGridIncrementalSearch::HeapSiftDown(int32 Index)
+{
+	FNodeRef NodeRef = Heap[Index];
+
+	while (true)
+	{
+		int32 ChildIndex = Index * 2 + 1;
+		if (ChildIndex >= Heap.Num())
+		{
+			break;
+		}
+
+		if (ChildIndex + 1 < Heap.Num() && Keys[Heap[ChildIndex + 1]] < Keys[Heap[ChildIndex]])
+		{
+			ChildIndex++;
+		}
+
+		if (!(Keys[Heap[ChildIndex]] < Keys[NodeRef]))
+		{
+			break;
+		}
+
+		HeapSet(Index, Heap[ChildIndex]);
+		Index = ChildIndex;
+	}
+
+	HeapSet(Index, NodeRef);
+}
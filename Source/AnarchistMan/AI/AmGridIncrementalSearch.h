@@ -0,0 +1,121 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+class FAmGridQueryFilter;
+
+/**
+ * FAmGridIncrementalSearch is a Lifelong Planning A* search that keeps its state between queries of the same agent.
+ * Tiles changed since the previous query are read from the grid change log, and only the part of the search
+ * affected by them is repaired.
+ * Tile costs depend on the time spent on the way, so the search is rooted at the start tile and is rebuilt
+ * when the start tile or the agent speed changes. A new goal only reorders the open list.
+ * Danger intervals are absolute, so the search also carries over while the grid time advances,
+ * until the time any evaluated tile's danger verdict may change at.
+ */
+class FAmGridIncrementalSearch
+{
+	struct FSearchKey
+	{
+		double Primary;
+		int64 Secondary;
+
+		FORCEINLINE bool operator<(const FSearchKey& Other) const
+		{
+			return Primary < Other.Primary || (Primary == Other.Primary && Secondary < Other.Secondary);
+		}
+	};
+
+public:
+
+	explicit FAmGridIncrementalSearch(const FAmGridData& InGrid);
+
+	/**
+	 * Find a path from StartNodeRef to EndNodeRef, reusing the previous search when possible.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 * If the goal is unreachable, the path to the node closest to the goal is stored.
+	 */
+	EGraphAStarResult FindPath(FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& QueryFilter, TArray<FAmGridPathNode>& OutPath);
+
+private:
+
+	void Reinitialize(FNodeRef InStartNodeRef);
+
+	bool ApplyChangedTiles();
+
+	void UpdateKeys();
+
+	void UpdateNode(FNodeRef NodeRef);
+
+	void ComputeShortestPath();
+
+	FSearchKey CalculateKey(FNodeRef NodeRef) const;
+
+	double GetHeuristicCost(FNodeRef NodeRef) const;
+
+	void StorePath(FNodeRef NodeRef, TArray<FAmGridPathNode>& OutPath) const;
+
+	/* Binary heap of inconsistent nodes that supports removal of any node. */
+
+	void HeapInsert(FNodeRef NodeRef);
+
+	void HeapRemove(FNodeRef NodeRef);
+
+	FNodeRef HeapPop();
+
+	void HeapSiftUp(int32 Index);
+
+	void HeapSiftDown(int32 Index);
+
+	FORCEINLINE void HeapSet(int32 Index, FNodeRef NodeRef)
+	{
+		Heap[Index] = NodeRef;
+		HeapIndices[NodeRef] = Index;
+	}
+
+private:
+
+	static constexpr int64 COST_INFINITE = TNumericLimits<int64>::Max();
+
+	const FAmGridData& Grid;
+
+	// Filter of the current query, only valid during FindPath.
+	const FAmGridQueryFilter* Filter;
+
+	FNodeRef StartNodeRef;
+
+	FNodeRef EndNodeRef;
+
+	float SpeedMultiplier;
+
+	// Grid change count the search is up to date with.
+	uint64 ChangeCount;
+
+	// Grid time the danger verdict of a tile evaluated since the search was started may change at.
+	float DangerChangeTime;
+
+	// Version of the filter heuristic the keys are computed with.
+	uint64 HeuristicVersion;
+
+	// Cost of the best known path to a tile (g).
+	TArray<int64> TraversalCosts;
+
+	// One step lookahead cost computed from the neighbours (rhs), a tile is consistent when both costs are equal.
+	TArray<int64> LookaheadCosts;
+
+	// Neighbour the lookahead cost was computed from.
+	TArray<FNodeRef> Parents;
+
+	TArray<FSearchKey> Keys;
+
+	// Position of a tile in Heap or INDEX_NONE.
+	TArray<int32> HeapIndices;
+
+	TArray<FNodeRef> Heap;
+
+	TArray<FNodeRef> ChangedTiles;
+};
@@ -0,0 +1,294 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridJumpPointSearch.h"
+
+#include "AmGridNavMesh.h"
+#include "AmGridQueryFilter.h"
+
+static FORCEINLINE bool IsHorizontal(EAmGridDirection::Type Direction)
+{
+	return Direction == EAmGridDirection::LEFT || Direction == EAmGridDirection::RIGHT;
+}
+
+static FORCEINLINE EAmGridDirection::Type GetOpposite(EAmGridDirection::Type Direction)
+{
+	// LEFT/RIGHT and UP/DOWN differ only in the lowest bit.
+	return static_cast<EAmGridDirection::Type>(Direction ^ 1);
+}
+
+void FAmGridJumpPointSearch::Reserve(int32 NumNodes)
+{
+	if (Epochs.Num() == NumNodes)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Grid_Navigation_SearchAllocations);
+
+	Epochs.Init(0, NumNodes);
+	NodeIndices.SetNumUninitialized(NumNodes);
+	Epoch = 0;
+}
+
+EGraphAStarResult FAmGridJumpPointSearch::FindPath(const FAmGridData& InGrid, FNodeRef StartNodeRef, FNodeRef InEndNodeRef, const FAmGridQueryFilter& InFilter, TArray<FAmGridPathNode>& OutPath)
+{
+	NodesExpanded = 0;
+
+	if (!(InGrid.IsValidIndex(StartNodeRef) && InGrid.IsWalkable(StartNodeRef) && InGrid.IsValidIndex(InEndNodeRef) && InGrid.IsWalkable(InEndNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == InEndNodeRef)
+	{
+		return SearchSuccess;
+	}
+
+	Grid = &InGrid;
+	Filter = &InFilter;
+	EndNodeRef = InEndNodeRef;
+
+	Reserve(InGrid.Num());
+
+	Epoch++;
+	if (Epoch == 0)
+	{
+		Epochs.Init(0, InGrid.Num());
+		Epoch = 1;
+	}
+
+	NodePool.Reset();
+	OpenList.Reset();
+
+	FNodeSorter NodeSorter{ NodePool };
+
+	// Kick off the search with the first node.
+	FJumpNode& StartNode = NodePool.AddDefaulted_GetRef();
+	StartNode.NodeRef = StartNodeRef;
+	StartNode.ParentIndex = INDEX_NONE;
+	StartNode.TraversalCost = 0;
+	StartNode.HeuristicCost = GetHeuristicCost(StartNodeRef);
+	StartNode.TotalCost = StartNode.HeuristicCost;
+	StartNode.Direction = EAmGridDirection::MAX;
+	StartNode.bIsClosed = false;
+
+	Epochs[StartNodeRef] = Epoch;
+	NodeIndices[StartNodeRef] = 0;
+	OpenList.HeapPush(0, NodeSorter);
+	BestNodeIndex = 0;
+
+	EGraphAStarResult Result = GoalUnreachable;
+
+	while (OpenList.Num() > 0)
+	{
+		int32 NodeIndex;
+		OpenList.HeapPop(NodeIndex, NodeSorter, false);
+
+		if (NodePool[NodeIndex].bIsClosed)
+		{
+			continue;
+		}
+
+		NodePool[NodeIndex].bIsClosed = true;
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+
+		// Copy, the pool can grow while successors are added.
+		const FJumpNode Node = NodePool[NodeIndex];
+
+		if (Node.NodeRef == EndNodeRef)
+		{
+			BestNodeIndex = NodeIndex;
+			Result = SearchSuccess;
+			break;
+		}
+
+		NodesExpanded++;
+
+		// Pruning only holds inside runs of plain tiles, so the start and non-plain tiles expand every direction.
+		const bool bExpandAll = Node.Direction == EAmGridDirection::MAX || !IsPlain(Node.NodeRef);
+
+		for (uint8 DirectionIndex = 0; DirectionIndex < EAmGridDirection::MAX; DirectionIndex++)
+		{
+			const auto Direction = static_cast<EAmGridDirection::Type>(DirectionIndex);
+
+			if (!HasNeighbour(Node.NodeRef, Direction))
+			{
+				continue;
+			}
+
+			if (Node.Direction != EAmGridDirection::MAX && Direction == GetOpposite(Node.Direction))
+			{
+				continue;
+			}
+
+			// A vertical run may turn to either side at any tile, a horizontal run turns only at forced neighbours.
+			bool bNatural = bExpandAll || Direction == Node.Direction || !IsHorizontal(Node.Direction);
+			if (!bNatural && !IsForcedDirection(Node.NodeRef, Node.Direction, Direction))
+			{
+				continue;
+			}
+
+			int32 Steps;
+			FNodeRef SuccessorRef = Jump(Node.NodeRef, Direction, Steps);
+			if (SuccessorRef != INDEX_NONE)
+			{
+				AddSuccessor(NodeIndex, SuccessorRef, Direction, Steps);
+			}
+		}
+	}
+
+	// No point to waste perf creating the path if querier doesn't want it.
+	if (Result == SearchSuccess || InFilter.WantsPartialSolution())
+	{
+		StorePath(BestNodeIndex, OutPath);
+	}
+
+	Grid = nullptr;
+	Filter = nullptr;
+
+	return Result;
+}
+
+bool FAmGridJumpPointSearch::IsSpecial(FNodeRef NodeRef, FNodeRef NeighbourRef) const
+{
+	// A tile that is not plain, but can still be entered, its cost has to be evaluated by the filter.
+	return !IsPlain(NeighbourRef) && Filter->IsTraversalAllowed(NodeRef, NeighbourRef);
+}
+
+bool FAmGridJumpPointSearch::HasForcedNeighbour(FNodeRef NodeRef, EAmGridDirection::Type Direction) const
+{
+	// Vertical runs scan both horizontal directions on every tile instead, see Jump.
+	return IsHorizontal(Direction) &&
+		(IsForcedDirection(NodeRef, Direction, EAmGridDirection::UP) || IsForcedDirection(NodeRef, Direction, EAmGridDirection::DOWN));
+}
+
+bool FAmGridJumpPointSearch::IsForcedDirection(FNodeRef NodeRef, EAmGridDirection::Type Direction, EAmGridDirection::Type Perpendicular) const
+{
+	if (!HasNeighbour(NodeRef, Perpendicular))
+	{
+		return false;
+	}
+
+	FNodeRef PerpendicularRef = Grid->GetNeighbourInDirection(NodeRef, Perpendicular);
+	if (!IsPlain(PerpendicularRef))
+	{
+		return IsSpecial(NodeRef, PerpendicularRef);
+	}
+
+	// The neighbour is forced if the route that turns one tile earlier is blocked.
+	FNodeRef BehindRef = Grid->GetNeighbourInDirection(NodeRef, GetOpposite(Direction));
+	return !HasNeighbour(BehindRef, Perpendicular) || !IsPlain(Grid->GetNeighbourInDirection(BehindRef, Perpendicular));
+}
+
+FNodeRef FAmGridJumpPointSearch::Jump(FNodeRef NodeRef, EAmGridDirection::Type Direction, int32& OutSteps) const
+{
+	FNodeRef CurrentRef = NodeRef;
+	OutSteps = 0;
+
+	while (HasNeighbour(CurrentRef, Direction))
+	{
+		FNodeRef NextRef = Grid->GetNeighbourInDirection(CurrentRef, Direction);
+		OutSteps++;
+
+		// Blocks, bombs and tiles with a timeout are always jump points, their cost is up to the filter.
+		if (!IsPlain(NextRef))
+		{
+			return Filter->IsTraversalAllowed(CurrentRef, NextRef) ? NextRef : INDEX_NONE;
+		}
+
+		if (NextRef == EndNodeRef || HasForcedNeighbour(NextRef, Direction))
+		{
+			return NextRef;
+		}
+
+		if (!IsHorizontal(Direction))
+		{
+			int32 Steps;
+			if (Jump(NextRef, EAmGridDirection::LEFT, Steps) != INDEX_NONE || Jump(NextRef, EAmGridDirection::RIGHT, Steps) != INDEX_NONE)
+			{
+				return NextRef;
+			}
+		}
+
+		CurrentRef = NextRef;
+	}
+
+	return INDEX_NONE;
+}
+
+void FAmGridJumpPointSearch::AddSuccessor(int32 ParentIndex, FNodeRef SuccessorRef, EAmGridDirection::Type Direction, int32 Steps)
+{
+	// Every tile jumped over is plain, so each of them costs exactly DEFAULT.
+	const int64 LastStepStartCost = NodePool[ParentIndex].TraversalCost + (Steps - 1) * ETileNavCost::DEFAULT;
+	const int64 TraversalCost = LastStepStartCost + Filter->GetNodeTraversalCost(LastStepStartCost, SuccessorRef);
+
+	int32 NodeIndex = FindNode(SuccessorRef);
+
+	if (NodeIndex != INDEX_NONE)
+	{
+		const FJumpNode& ExistingNode = NodePool[NodeIndex];
+		if (ExistingNode.bIsClosed || ExistingNode.TraversalCost <= TraversalCost)
+		{
+			return;
+		}
+	}
+	else
+	{
+		NodeIndex = NodePool.AddDefaulted();
+		Epochs[SuccessorRef] = Epoch;
+		NodeIndices[SuccessorRef] = NodeIndex;
+
+		FJumpNode& NewNode = NodePool[NodeIndex];
+		NewNode.NodeRef = SuccessorRef;
+		NewNode.HeuristicCost = GetHeuristicCost(SuccessorRef);
+		NewNode.bIsClosed = false;
+	}
+
+	FJumpNode& Node = NodePool[NodeIndex];
+	Node.ParentIndex = ParentIndex;
+	Node.TraversalCost = TraversalCost;
+	Node.TotalCost = double(TraversalCost) + Node.HeuristicCost;
+	Node.Direction = Direction;
+
+	OpenList.HeapPush(NodeIndex, FNodeSorter{ NodePool });
+
+	if (Node.HeuristicCost < NodePool[BestNodeIndex].HeuristicCost)
+	{
+		BestNodeIndex = NodeIndex;
+	}
+}
+
+double FAmGridJumpPointSearch::GetHeuristicCost(FNodeRef NodeRef) const
+{
+	return Filter->GetHeuristicCost(NodeRef, EndNodeRef) * Filter->GetHeuristicScale();
+}
+
+void FAmGridJumpPointSearch::StorePath(int32 NodeIndex, TArray<FAmGridPathNode>& OutPath) const
+{
+	TArray<int32, TInlineAllocator<64>> JumpPoints;
+	for (int32 Index = NodeIndex; Index != INDEX_NONE; Index = NodePool[Index].ParentIndex)
+	{
+		JumpPoints.Add(Index);
+	}
+
+	OutPath.Reset();
+
+	// Jump points are stored from the goal to the start, fill in the tiles jumped over between them.
+	for (int32 JumpIndex = JumpPoints.Num() - 1; JumpIndex > 0; JumpIndex--)
+	{
+		const FJumpNode& FromNode = NodePool[JumpPoints[JumpIndex]];
+		const FJumpNode& ToNode = NodePool[JumpPoints[JumpIndex - 1]];
+
+		const int32 Offset = Grid->GetDirectionOffset(ToNode.Direction);
+		const int32 Steps = (ToNode.NodeRef - FromNode.NodeRef) / Offset;
+
+		FNodeRef NodeRef = FromNode.NodeRef;
+		for (int32 Step = 1; Step < Steps; Step++)
+		{
+			NodeRef += Offset;
+			OutPath.Add({ NodeRef, FromNode.TraversalCost + Step * ETileNavCost::DEFAULT });
+		}
+
+		OutPath.Add({ ToNode.NodeRef, ToNode.TraversalCost });
+	}
+}
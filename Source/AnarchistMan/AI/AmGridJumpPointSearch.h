@@ -0,0 +1,114 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+class FAmGridQueryFilter;
+
+/**
+ * FAmGridJumpPointSearch is an A* variant for the 4-connected arena grid (Jump Point Search).
+ * Runs of plain tiles (no block, no bomb, no explosion timeout) are jumped over instead of being expanded one by one.
+ * Every tile that is not plain becomes a jump point, so its cost is still computed by the query filter
+ * and the result has the same BLOCK/BOMB semantics as FAmGridAStar.
+ * Like FAmGridAStar, an instance is meant to be kept per thread: the tile lookup is stamped with the search epoch and never cleared.
+ */
+class FAmGridJumpPointSearch
+{
+	struct FJumpNode
+	{
+		FNodeRef NodeRef;
+		int32 ParentIndex;
+		int64 TraversalCost;
+		double TotalCost;
+		double HeuristicCost;
+		// Direction of the last jump, MAX for the start node.
+		EAmGridDirection::Type Direction;
+		bool bIsClosed;
+	};
+
+	struct FNodeSorter
+	{
+		const TArray<FJumpNode>& NodePool;
+
+		FORCEINLINE bool operator()(int32 A, int32 B) const
+		{
+			return NodePool[A].TotalCost < NodePool[B].TotalCost;
+		}
+	};
+
+public:
+
+	// Size the tile lookup for a grid of NumNodes tiles, FindPath does it on its own when the grid changes.
+	void Reserve(int32 NumNodes);
+
+	/**
+	 * Find a path from StartNodeRef to EndNodeRef.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 * If the goal is unreachable, the path to the node closest to the goal is stored.
+	 */
+	EGraphAStarResult FindPath(const FAmGridData& InGrid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& InFilter, TArray<FAmGridPathNode>& OutPath);
+
+	// Number of jump points expanded by the last search.
+	FORCEINLINE int32 GetNodesExpanded() const
+	{
+		return NodesExpanded;
+	}
+
+private:
+
+	FORCEINLINE int32 FindNode(FNodeRef NodeRef) const
+	{
+		return Epochs[NodeRef] == Epoch ? NodeIndices[NodeRef] : INDEX_NONE;
+	}
+
+	FORCEINLINE bool HasNeighbour(FNodeRef NodeRef, EAmGridDirection::Type Direction) const
+	{
+		return (Grid->GetNeighbourMask(NodeRef) & (1 << Direction)) != 0;
+	}
+
+	FORCEINLINE bool IsPlain(FNodeRef NodeRef) const
+	{
+		return Grid->GetType(NodeRef) == ETileType::DEFAULT && !Grid->HasTimeout(NodeRef);
+	}
+
+	bool IsSpecial(FNodeRef NodeRef, FNodeRef NeighbourRef) const;
+
+	bool HasForcedNeighbour(FNodeRef NodeRef, EAmGridDirection::Type Direction) const;
+
+	bool IsForcedDirection(FNodeRef NodeRef, EAmGridDirection::Type Direction, EAmGridDirection::Type Perpendicular) const;
+
+	FNodeRef Jump(FNodeRef NodeRef, EAmGridDirection::Type Direction, int32& OutSteps) const;
+
+	void AddSuccessor(int32 ParentIndex, FNodeRef SuccessorRef, EAmGridDirection::Type Direction, int32 Steps);
+
+	double GetHeuristicCost(FNodeRef NodeRef) const;
+
+	void StorePath(int32 NodeIndex, TArray<FAmGridPathNode>& OutPath) const;
+
+private:
+
+	// Grid and filter of the current query, only valid during FindPath.
+	const FAmGridData* Grid = nullptr;
+
+	const FAmGridQueryFilter* Filter = nullptr;
+
+	FNodeRef EndNodeRef = INDEX_NONE;
+
+	int32 BestNodeIndex = INDEX_NONE;
+
+	int32 NodesExpanded = 0;
+
+	TArray<FJumpNode> NodePool;
+
+	// Pool index per tile, only valid if the epoch of the tile is the current one.
+	TArray<int32> NodeIndices;
+
+	TArray<uint32> Epochs;
+
+	uint32 Epoch = 0;
+
+	TArray<int32> OpenList;
+};
@@ -0,0 +1,259 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridLandmarks.h"
+
+#include "AmGridNavMesh.h"
+
+static FORCEINLINE bool SortByCost(const FAmGridPathNode& A, const FAmGridPathNode& B)
+{
+	return A.TraversalCost < B.TraversalCost;
+}
+
+void FAmGridLandmarks::Init(const FAmGridData& Grid, int32 NumLandmarks)
+{
+	NumRequestedLandmarks = NumLandmarks;
+	NumTiles = Grid.Num();
+	Landmarks.Reset();
+
+	NumLandmarks = FMath::Clamp(NumLandmarks, 0, MAX_LANDMARKS);
+	if (NumLandmarks == 0)
+	{
+		return;
+	}
+
+	const int32 Columns = Grid.GetColumns();
+
+	// Farthest point selection, every next landmark is the walkable tile farthest from the ones already picked.
+	TArray<int32> Distances;
+	Distances.Init(MAX_int32, NumTiles);
+
+	FNodeRef NextNodeRef = INDEX_NONE;
+	for (FNodeRef NodeRef = 0; NodeRef < NumTiles && NextNodeRef == INDEX_NONE; NodeRef++)
+	{
+		if (Grid.IsWalkable(NodeRef))
+		{
+			NextNodeRef = NodeRef;
+		}
+	}
+
+	while (NextNodeRef != INDEX_NONE && Landmarks.Num() < NumLandmarks)
+	{
+		Landmarks.AddDefaulted_GetRef().NodeRef = NextNodeRef;
+
+		const int32 LandmarkX = NextNodeRef % Columns;
+		const int32 LandmarkY = NextNodeRef / Columns;
+
+		int32 BestDistance = 0;
+		NextNodeRef = INDEX_NONE;
+
+		for (FNodeRef NodeRef = 0; NodeRef < NumTiles; NodeRef++)
+		{
+			if (!Grid.IsWalkable(NodeRef))
+			{
+				continue;
+			}
+
+			int32 Distance = FMath::Abs(NodeRef % Columns - LandmarkX) + FMath::Abs(NodeRef / Columns - LandmarkY);
+			Distances[NodeRef] = FMath::Min(Distances[NodeRef], Distance);
+
+			if (Distances[NodeRef] > BestDistance)
+			{
+				BestDistance = Distances[NodeRef];
+				NextNodeRef = NodeRef;
+			}
+		}
+	}
+
+	Rebuild(Grid);
+}
+
+void FAmGridLandmarks::Update(const FAmGridData& Grid, int32 NumLandmarks)
+{
+	if (NumLandmarks != NumRequestedLandmarks || NumTiles != Grid.Num())
+	{
+		Init(Grid, NumLandmarks);
+		return;
+	}
+
+	if (!IsValid() || GridChangeCount == Grid.GetChangeCount())
+	{
+		return;
+	}
+
+	if (!Grid.GetChangedTiles(GridChangeCount, ChangedTiles))
+	{
+		Rebuild(Grid);
+		return;
+	}
+
+	GridChangeCount = Grid.GetChangeCount();
+	DecreasedTiles.Reset();
+
+	for (FNodeRef NodeRef : ChangedTiles)
+	{
+		const int64 Cost = Grid.GetCost(NodeRef);
+		if (Cost < TileCosts[NodeRef])
+		{
+			TileCosts[NodeRef] = Cost;
+			DecreasedTiles.Add(NodeRef);
+		}
+
+		// The same tile is logged on every timeout change, count it once.
+		const bool bIsIncreased = Cost > TileCosts[NodeRef];
+		if (IncreasedTiles[NodeRef] != bIsIncreased)
+		{
+			IncreasedTiles[NodeRef] = bIsIncreased;
+			NumIncreasedTiles += bIsIncreased ? 1 : -1;
+		}
+	}
+
+	if (NumIncreasedTiles > NumTiles / 32)
+	{
+		Rebuild(Grid);
+		return;
+	}
+
+	if (DecreasedTiles.Num() == 0)
+	{
+		return;
+	}
+
+	for (FLandmark& Landmark : Landmarks)
+	{
+		// A cheaper tile is cheaper to enter, so paths from the landmark get shorter at the tile itself...
+		SeedTiles.Reset();
+		for (FNodeRef NodeRef : DecreasedTiles)
+		{
+			const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+			for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+			{
+				const int64 NeighbourCost = Landmark.FromCosts[Grid.GetNeighbour(NodeRef, NeighbourIdx)];
+				if (NeighbourCost != COST_INFINITE && NeighbourCost + TileCosts[NodeRef] < Landmark.FromCosts[NodeRef])
+				{
+					Landmark.FromCosts[NodeRef] = NeighbourCost + TileCosts[NodeRef];
+					SeedTiles.Add(NodeRef);
+				}
+			}
+		}
+		Propagate(Grid, Landmark.FromCosts, false);
+
+		// ...and paths to the landmark get shorter at the neighbours stepping on it.
+		SeedTiles.Reset();
+		for (FNodeRef NodeRef : DecreasedTiles)
+		{
+			if (Landmark.ToCosts[NodeRef] == COST_INFINITE)
+			{
+				continue;
+			}
+
+			const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+			for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+			{
+				const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(NodeRef, NeighbourIdx);
+				if (TileCosts[NodeRef] + Landmark.ToCosts[NodeRef] < Landmark.ToCosts[NeighbourNodeRef])
+				{
+					Landmark.ToCosts[NeighbourNodeRef] = TileCosts[NodeRef] + Landmark.ToCosts[NodeRef];
+					SeedTiles.Add(NeighbourNodeRef);
+				}
+			}
+		}
+		Propagate(Grid, Landmark.ToCosts, true);
+	}
+
+	Version++;
+}
+
+int64 FAmGridLandmarks::GetHeuristicCost(FNodeRef StartNodeRef, FNodeRef EndNodeRef) const
+{
+	int64 HeuristicCost = 0;
+
+	for (const FLandmark& Landmark : Landmarks)
+	{
+		// Cost(Landmark, End) <= Cost(Landmark, Start) + Cost(Start, End)
+		const int64 StartFromCost = Landmark.FromCosts[StartNodeRef];
+		const int64 EndFromCost = Landmark.FromCosts[EndNodeRef];
+		if (StartFromCost != COST_INFINITE && EndFromCost != COST_INFINITE)
+		{
+			HeuristicCost = FMath::Max(HeuristicCost, EndFromCost - StartFromCost);
+		}
+
+		// Cost(Start, Landmark) <= Cost(Start, End) + Cost(End, Landmark)
+		const int64 StartToCost = Landmark.ToCosts[StartNodeRef];
+		const int64 EndToCost = Landmark.ToCosts[EndNodeRef];
+		if (StartToCost != COST_INFINITE && EndToCost != COST_INFINITE)
+		{
+			HeuristicCost = FMath::Max(HeuristicCost, StartToCost - EndToCost);
+		}
+	}
+
+	return HeuristicCost;
+}
+
+void FAmGridLandmarks::Rebuild(const FAmGridData& Grid)
+{
+	GridChangeCount = Grid.GetChangeCount();
+
+	TileCosts.SetNumUninitialized(NumTiles);
+	for (FNodeRef NodeRef = 0; NodeRef < NumTiles; NodeRef++)
+	{
+		TileCosts[NodeRef] = Grid.GetCost(NodeRef);
+	}
+
+	IncreasedTiles.Init(false, NumTiles);
+	NumIncreasedTiles = 0;
+
+	for (FLandmark& Landmark : Landmarks)
+	{
+		SeedTiles.Reset();
+		SeedTiles.Add(Landmark.NodeRef);
+
+		Landmark.FromCosts.Init(COST_INFINITE, NumTiles);
+		Landmark.FromCosts[Landmark.NodeRef] = 0;
+		Propagate(Grid, Landmark.FromCosts, false);
+
+		Landmark.ToCosts.Init(COST_INFINITE, NumTiles);
+		Landmark.ToCosts[Landmark.NodeRef] = 0;
+		Propagate(Grid, Landmark.ToCosts, true);
+	}
+
+	Version++;
+}
+
+void FAmGridLandmarks::Propagate(const FAmGridData& Grid, TArray<int64>& Costs, bool bBackwards)
+{
+	OpenList.Reset();
+	for (FNodeRef NodeRef : SeedTiles)
+	{
+		OpenList.HeapPush({ NodeRef, Costs[NodeRef] }, SortByCost);
+	}
+
+	while (OpenList.Num() > 0)
+	{
+		FAmGridPathNode CurrentNode;
+		OpenList.HeapPop(CurrentNode, SortByCost, false);
+
+		// Skip entries of tiles that have been reached cheaper since they were pushed.
+		if (CurrentNode.TraversalCost > Costs[CurrentNode.NodeRef])
+		{
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesSettled);
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(CurrentNode.NodeRef);
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			const FNodeRef NeighbourNodeRef = Grid.GetNeighbour(CurrentNode.NodeRef, NeighbourIdx);
+
+			// Backwards, the neighbour steps on the current tile to get closer to the landmark.
+			const int64 StepCost = bBackwards ? TileCosts[CurrentNode.NodeRef] : TileCosts[NeighbourNodeRef];
+			const int64 NeighbourCost = CurrentNode.TraversalCost + StepCost;
+
+			if (NeighbourCost < Costs[NeighbourNodeRef])
+			{
+				Costs[NeighbourNodeRef] = NeighbourCost;
+				OpenList.HeapPush({ NeighbourNodeRef, NeighbourCost }, SortByCost);
+			}
+		}
+	}
+}
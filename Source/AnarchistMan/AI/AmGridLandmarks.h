@@ -0,0 +1,93 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/AmGridData.h"
+
+/**
+ * FAmGridLandmarks keeps the costs from and to a few landmark tiles for every tile of the grid (ALT heuristic).
+ * By the triangle inequality, the cost between two tiles is at least the difference of their costs to any landmark,
+ * which is much tighter than the Manhattan distance once breakable blocks make some tiles a million times more expensive.
+ *
+ * The tables are computed with static tile costs, which never exceed the costs of the query filter,
+ * so the heuristic stays admissible. Cheaper tiles (destroyed blocks, exploded bombs) are propagated incrementally.
+ * A tile that gets more expensive keeps its old cost, the tables are then exact for a cheaper grid and still a lower bound,
+ * they are rebuilt once enough tiles got more expensive.
+ */
+class FAmGridLandmarks
+{
+public:
+
+	static constexpr int32 MAX_LANDMARKS = 8;
+
+	// Pick up to NumLandmarks landmarks spread over the grid and compute their tables.
+	void Init(const FAmGridData& Grid, int32 NumLandmarks);
+
+	// Bring the tables up to date with the grid, initialize them if the grid or number of landmarks changed.
+	void Update(const FAmGridData& Grid, int32 NumLandmarks);
+
+	FORCEINLINE bool IsValid() const
+	{
+		return Landmarks.Num() > 0;
+	}
+
+	// Incremented every time the tables change, so searches that cache heuristic values know when to refresh them.
+	FORCEINLINE uint64 GetVersion() const
+	{
+		return Version;
+	}
+
+	// Lower bound of the cost from StartNodeRef to EndNodeRef.
+	int64 GetHeuristicCost(FNodeRef StartNodeRef, FNodeRef EndNodeRef) const;
+
+private:
+
+	struct FLandmark
+	{
+		FNodeRef NodeRef;
+
+		// Cost from the landmark to every tile.
+		TArray<int64> FromCosts;
+
+		// Cost from every tile to the landmark.
+		TArray<int64> ToCosts;
+	};
+
+	void Rebuild(const FAmGridData& Grid);
+
+	// Propagate cost decreases from SeedTiles, forward from the landmark or backwards to it.
+	void Propagate(const FAmGridData& Grid, TArray<int64>& Costs, bool bBackwards);
+
+private:
+
+	static constexpr int64 COST_INFINITE = TNumericLimits<int64>::Max();
+
+	int32 NumRequestedLandmarks = 0;
+
+	int32 NumTiles = 0;
+
+	uint64 GridChangeCount = 0;
+
+	uint64 Version = 0;
+
+	// Tiles that got more expensive since the last rebuild.
+	TBitArray<> IncreasedTiles;
+
+	int32 NumIncreasedTiles = 0;
+
+	TArray<FLandmark, TInlineAllocator<MAX_LANDMARKS>> Landmarks;
+
+	// Tile costs the tables are computed with.
+	TArray<int64> TileCosts;
+
+	/* Scratch buffers reused between updates. */
+
+	TArray<FNodeRef> ChangedTiles;
+
+	TArray<FNodeRef> DecreasedTiles;
+
+	TArray<FNodeRef> SeedTiles;
+
+	TArray<FAmGridPathNode> OpenList;
+};
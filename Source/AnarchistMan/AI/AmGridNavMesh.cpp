@@ -3,12 +3,151 @@
 #include "AmGridNavMesh.h"
 
 #include "AIModule/Public/GraphAStar.h"
+#include "Async/Async.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "Kismet/GameplayStatics.h"
 
+#include "AmGridAStar.h"
+#include "AmGridFlowField.h"
+#include "AmGridIncrementalSearch.h"
+#include "AmGridJumpPointSearch.h"
+#include "AmGridPath.h"
 #include "AmGridQueryFilter.h"
+#include "AmGridSpaceTimeSearch.h"
 #include "Player/AmMainPlayerCharacter.h"
 
+/**
+ * Monotone priority queue of path nodes keyed by traversal cost (radix heap).
+ * A node goes to the bucket of the highest bit its cost differs from the last popped cost in,
+ * so tier costs that are orders of magnitude apart don't cost more than plain steps.
+ */
+struct FGridRadixHeap
+{
+	void Reset()
+	{
+		for (TArray<FAmGridPathNode>& Bucket : Buckets)
+		{
+			Bucket.Reset();
+		}
+
+		LastCost = 0;
+		Num = 0;
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Num == 0;
+	}
+
+	// Cost must not be less than the cost of the last popped node.
+	FORCEINLINE void Push(const FAmGridPathNode& Node)
+	{
+		checkSlow(Node.TraversalCost >= LastCost);
+		Buckets[GetBucketIndex(Node.TraversalCost)].Add(Node);
+		Num++;
+	}
+
+	FAmGridPathNode Pop()
+	{
+		if (Buckets[0].Num() == 0)
+		{
+			int32 BucketIndex = 1;
+			while (Buckets[BucketIndex].Num() == 0)
+			{
+				BucketIndex++;
+			}
+
+			// Redistribute the first non-empty bucket around its minimum, every node moves to a lower bucket.
+			LastCost = TNumericLimits<int64>::Max();
+			for (const FAmGridPathNode& Node : Buckets[BucketIndex])
+			{
+				LastCost = FMath::Min(LastCost, Node.TraversalCost);
+			}
+
+			for (const FAmGridPathNode& Node : Buckets[BucketIndex])
+			{
+				Buckets[GetBucketIndex(Node.TraversalCost)].Add(Node);
+			}
+
+			Buckets[BucketIndex].Reset();
+		}
+
+		Num--;
+		return Buckets[0].Pop(false);
+	}
+
+private:
+
+	FORCEINLINE int32 GetBucketIndex(int64 Cost) const
+	{
+		const uint64 Diff = uint64(Cost ^ LastCost);
+		return Diff == 0 ? 0 : 64 - FMath::CountLeadingZeros64(Diff);
+	}
+
+private:
+
+	TArray<FAmGridPathNode> Buckets[65];
+
+	int64 LastCost = 0;
+
+	int32 Num = 0;
+};
+
+/**
+ * Scratch buffers reused by every search on a thread, so a search doesn't allocate once they are warmed up.
+ * Visited costs are only valid for entries stamped with the current epoch, so the arrays are never cleared between searches.
+ */
+struct FGridSearchScratch
+{
+	void Begin(int32 NumNodes)
+	{
+		Epoch++;
+		if (VisitedEpochs.Num() != NumNodes || Epoch == 0)
+		{
+			VisitedEpochs.Init(0, NumNodes);
+			VisitedCosts.SetNumUninitialized(NumNodes);
+			Epoch = 1;
+		}
+
+		OpenList.Reset();
+	}
+
+	FORCEINLINE bool IsVisited(FNodeRef NodeRef) const
+	{
+		return VisitedEpochs[NodeRef] == Epoch;
+	}
+
+	FORCEINLINE int64 GetVisitedCost(FNodeRef NodeRef) const
+	{
+		return IsVisited(NodeRef) ? VisitedCosts[NodeRef] : TNumericLimits<int64>::Max();
+	}
+
+	FORCEINLINE void SetVisitedCost(FNodeRef NodeRef, int64 Cost)
+	{
+		VisitedEpochs[NodeRef] = Epoch;
+		VisitedCosts[NodeRef] = Cost;
+	}
+
+public:
+
+	FGridRadixHeap OpenList;
+
+private:
+
+	TArray<int64> VisitedCosts;
+
+	TArray<uint32> VisitedEpochs;
+
+	uint32 Epoch = 0;
+};
+
+static thread_local FGridSearchScratch GridSearchScratch;
+
+static thread_local FAmGridAStar GridAStar;
+
+static thread_local FAmGridJumpPointSearch GridJumpPointSearch;
+
+static thread_local FAmGridSpaceTimeSearch GridSpaceTimeSearch;
+
 static float GetSpeedMultiplier(const AActor* Owner)
 {
 	const auto* Controller = Cast<const AController>(Owner);
@@ -26,6 +165,18 @@ AAmGridNavMesh::AAmGridNavMesh()
 	Rows = 5;
 	Columns = 5;
 
+	PathfindingMode = EAmGridPathfindingMode::AStar;
+
+	NextPathQueryId = 1;
+	CharacterTilesVersion = 0;
+
+	// Matches AAmExplosion life span.
+	TileExplosionDuration = 1.f;
+	FlowFieldDangerTime = 1.f;
+	HierarchyClusterSize = 16;
+	LandmarkCount = 4;
+	PathCacheSize = 32;
+
 	FindPathImplementation = FindPath;
 	TestPathImplementation = TestPath;
 }
@@ -34,9 +185,16 @@ void AAmGridNavMesh::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
+	// Danger intervals are absolute, relative queries are answered at the time of this frame.
+	Grid.SetTime(GetWorld()->GetTimeSeconds());
+
+	DispatchAsyncPathQueries();
+
+	UpdatePathWatches();
+
 	if (bDrawDebugShapes)
 	{
-		for (FNodeRef NodeRef = 0; NodeRef < TileCosts.Num(); NodeRef++)
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
 		{
 			FVector Location = NodeRefToLocation(NodeRef);
 			Location.Z += FAmUtils::Unit;
@@ -44,30 +202,32 @@ void AAmGridNavMesh::Tick(float DeltaSeconds)
 			FString Text;
 			FColor Color;
 
+			float TileTimeout = Grid.GetTimeout(NodeRef);
+
 			// Worst case of time to pass 100 units * 2 = 0.7
-			if (TileTimeouts[NodeRef] > 0.7f)
+			if (TileTimeout > 0.7f)
 			{
 				Color = FColor::Yellow;
 			}
-			else if (TileTimeouts[NodeRef] >= 0.f)
+			else if (TileTimeout >= 0.f)
 			{
 				Color = FColor::Red;
 			}
-			else if (TileTimeouts[NodeRef] != TIMEOUT_UNSET)
+			else if (TileTimeout != TIMEOUT_UNSET)
 			{
 				Color = FColor::White;
 			}
 			else
 			{
-				switch (TileCosts[NodeRef])
+				switch (Grid.GetType(NodeRef))
 				{
-				case ETileNavCost::DEFAULT:
+				case ETileType::DEFAULT:
 					Color = FColor::Green;
 					break;
-				case ETileNavCost::BLOCK:
+				case ETileType::BLOCK:
 					Color = FColor::Black;
 					break;
-				case ETileNavCost::BOMB:
+				case ETileType::BOMB:
 					Color = FColor::Red;
 					break;
 				default:
@@ -87,9 +247,20 @@ void AAmGridNavMesh::BeginPlay()
 	FAmGridQueryFilter QueryFilter(this, 1.f, bDrawDebugShapes);
 	DefaultQueryFilter->SetFilterImplementation(&QueryFilter);
 
-	TileCosts.Init(ETileNavCost::DEFAULT, Columns * Rows);
+	Grid.Init(Rows, Columns);
+
+	// Game thread searches start with buffers sized to the arena, worker threads size theirs on the first search.
+	GridAStar.Reserve(Grid.Num());
+}
+
+void AAmGridNavMesh::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Batches in flight read the nav mesh.
+	FTaskGraphInterface::Get().WaitUntilTasksComplete(PathBatchTasks);
+	PathBatchTasks.Reset();
+	PendingPathQueries.Reset();
 
-	TileTimeouts.Init(TIMEOUT_UNSET, Columns * Rows);
+	Super::EndPlay(EndPlayReason);
 }
 
 FPathFindingResult AAmGridNavMesh::FindPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query)
@@ -109,126 +280,258 @@ FPathFindingResult AAmGridNavMesh::FindPath(const FNavAgentProperties& AgentProp
 	FPathFindingResult Result(ENavigationQueryResult::Error);
 
 	FNavigationPath* NavPath = Query.PathInstanceToFill.Get();
-	FNavMeshPath* NavMeshPath = NavPath ? NavPath->CastPath<FNavMeshPath>() : nullptr;
+	FAmGridPath* GridPath = NavPath ? NavPath->CastPath<FAmGridPath>() : nullptr;
 
-	if (NavMeshPath)
+	if (GridPath)
 	{
 		Result.Path = Query.PathInstanceToFill;
-		NavMeshPath->ResetForRepath();
+		GridPath->ResetForRepath();
 	}
 	else
 	{
-		Result.Path = Self->CreatePathInstance<FNavMeshPath>(Query);
+		Result.Path = Self->CreatePathInstance<FAmGridPath>(Query);
 		NavPath = Result.Path.Get();
-		NavMeshPath = NavPath ? NavPath->CastPath<FNavMeshPath>() : nullptr;
+		GridPath = NavPath ? NavPath->CastPath<FAmGridPath>() : nullptr;
+	}
+
+	const FNavigationQueryFilter* NavFilter = Query.QueryFilter.Get();
+	if (GridPath && NavFilter && NavFilter->GetImplementation())
+	{
+		// Each query gets its own copy of the filter, so concurrent queries don't share the speed multiplier.
+		FAmGridQueryFilter QueryFilter(*static_cast<const FAmGridQueryFilter*>(NavFilter->GetImplementation()));
+		QueryFilter.SetSpeedMultiplier(GetSpeedMultiplier(Cast<const AActor>(Query.Owner)));
+
+		Result.Result = NavMesh->FillPath(Query.StartLocation, Query.EndLocation, NavMesh->GetActorLocation().Z, QueryFilter, *GridPath, Query.Owner.Get());
 	}
 
+	return Result;
+}
+
+ENavigationQueryResult::Type AAmGridNavMesh::FillPath(FVector QueryStartLocation, FVector QueryEndLocation, float LocationZ, const FAmGridQueryFilter& QueryFilter, FAmGridPath& GridPath, const UObject* Querier) const
+{
+	ENavigationQueryResult::Type Result = ENavigationQueryResult::Error;
+
+	// On-screen messages and debug drawing are only allowed on the game thread.
+	const bool bShowDebug = IsInGameThread();
+
 	float TraversalCost = 0.f;
 
-	FVector StartLocation = FAmUtils::RoundToUnitCenter(Query.StartLocation);
-	StartLocation.Z = NavMesh->GetActorLocation().Z;
+	FVector StartLocation = FAmUtils::RoundToUnitCenter(QueryStartLocation);
+	StartLocation.Z = LocationZ;
 
-	FVector EndLocation = FAmUtils::RoundToUnitCenter(Query.EndLocation);
-	EndLocation.Z = NavMesh->GetActorLocation().Z;
+	FVector EndLocation = FAmUtils::RoundToUnitCenter(QueryEndLocation);
+	EndLocation.Z = LocationZ;
 
-	FNodeRef StartNodeRef = NavMesh->LocationToNodeRef(StartLocation);
-	FNodeRef EndNodeRef = NavMesh->LocationToNodeRef(EndLocation);
+	FNodeRef StartNodeRef = LocationToNodeRef(StartLocation);
+	FNodeRef EndNodeRef = LocationToNodeRef(EndLocation);
 
-	if (NavMesh->bShowDebugText)
+	if (bShowDebugText && bShowDebug)
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 0.1f, FColor::Yellow, FString::Printf(TEXT("FindPath from %d to %d"), StartNodeRef, EndNodeRef));
 	}
 
-	const FNavigationQueryFilter* NavFilter = Query.QueryFilter.Get();
-	if (NavMeshPath && NavFilter && NavFilter->GetImplementation())
+	if ((StartLocation - EndLocation).IsNearlyZero(10.f) == true)
+	{
+		GridPath.SetNodeRefs(MakeArrayView(&EndNodeRef, 1), EndLocation, *this);
+		Result = ENavigationQueryResult::Success;
+	}
+	else
 	{
-		NavMeshPath->ApplyFlags(Query.NavDataFlags);
+		// Kept per thread, so a query doesn't allocate once the buffers have grown to the path lengths seen.
+		static thread_local FResultPathNodes PathNodes;
+		PathNodes.Reset();
+		PathNodes.bIsPartial = false;
+		EGraphAStarResult AStarResult = FindPathNodes(StartNodeRef, EndNodeRef, QueryFilter, PathNodes, Querier);
 
-		if ((StartLocation - EndLocation).IsNearlyZero(10.f) == true)
+		switch (AStarResult)
 		{
-			Result.Path->GetPathPoints().Reset();
-			Result.Path->GetPathPoints().Add(FNavPathPoint(EndLocation));
-			Result.Result = ENavigationQueryResult::Success;
-		}
-		else
+		case GoalUnreachable:
+			Result = ENavigationQueryResult::Invalid;
+			break;
+		case InfiniteLoop:
+			Result = ENavigationQueryResult::Error;
+			break;
+		case SearchFail:
+			Result = ENavigationQueryResult::Fail;
+			break;
+		case SearchSuccess:
 		{
-			// Reset path points.
-			Result.Path->GetPathPoints().Reset();
+			Result = ENavigationQueryResult::Success;
 
-			FGridGraphAStar Pathfinder(*NavMesh);
-			const auto* GridQueryFilter = static_cast<const FAmGridQueryFilter*>(NavFilter->GetImplementation());
-			GridQueryFilter->SetSpeedMultiplier(GetSpeedMultiplier(Cast<const AActor>(Query.Owner)));
-			FResultPathNodes PathNodes;
-			EGraphAStarResult AStarResult = Pathfinder.FindPath(StartNodeRef, EndNodeRef, *GridQueryFilter, PathNodes);
+			// Add the starting tile manually, because we can also leave it, so we don't need to check if it's dangerous.
+			static thread_local TArray<FNodeRef> PathNodeRefs;
+			if (PathNodeRefs.Max() < PathNodes.Num() + 1)
+			{
+				INC_DWORD_STAT(STAT_Grid_Navigation_SearchAllocations);
+			}
+			PathNodeRefs.Reset(PathNodes.Num() + 1);
+			PathNodeRefs.Add(StartNodeRef);
 
-			switch (AStarResult)
+			for (const FNodeDescription& PathNode : PathNodes)
 			{
-			case GoalUnreachable:
-				Result.Result = ENavigationQueryResult::Invalid;
-				break;
-			case InfiniteLoop:
-				Result.Result = ENavigationQueryResult::Error;
-				break;
-			case SearchFail:
-				Result.Result = ENavigationQueryResult::Fail;
-				break;
-			case SearchSuccess:
+				// If the path is blocked by a bomb or something more dangerous, mark this path as invalid.
+				if (PathNode.TraversalCost >= ETileNavCost::BOMB)
+				{
+					Result = ENavigationQueryResult::Invalid;
+					break;
+				}
+				// If the path is blocked by a breakable block, end the path in front of the block and report path as partial.
+				else if (PathNode.TraversalCost >= ETileNavCost::BLOCK)
+				{
+					GridPath.SetIsPartial(true);
+					break;
+				}
+
+				PathNodeRefs.Add(PathNode.NodeRef);
+				TraversalCost = PathNode.TraversalCost;
+			}
+
+			// The agent has to wait at the end of the path, it replans once there.
+			if (PathNodes.bIsPartial && Result == ENavigationQueryResult::Success)
 			{
-				Result.Result = ENavigationQueryResult::Success;
+				GridPath.SetIsPartial(true);
+			}
 
-				// Add the starting tile manually, because we can also leave it, so we don't need to check if it's dangerous.
-				Result.Path->GetPathPoints().Add(FNavPathPoint(StartLocation));
+			GridPath.SetNodeRefs(PathNodeRefs, StartLocation, *this);
 
-				FVector PrevNodeLocation = StartLocation;
+			// A path should have at least two points to be valid.
+			if (GridPath.IsPartial() && GridPath.GetPathPoints().Num() < 2)
+			{
+				GridPath.GetPathPoints().Add(FNavPathPoint(StartLocation));
+			}
 
-				for (const FNodeDescription& PathNode : PathNodes)
-				{
-					// If the path is blocked by a bomb or something more dangerous, mark this path as invalid.
-					if (PathNode.TraversalCost >= ETileNavCost::BOMB)
-					{
-						Result.Result = ENavigationQueryResult::Invalid;
-						break;
-					}
-					// If the path is blocked by a breakable block, end the path in front of the block and report path as partial.
-					else if (PathNode.TraversalCost >= ETileNavCost::BLOCK)
-					{
-						Result.Path->SetIsPartial(true);
+			if (bDrawDebugShapes && bShowDebug)
+			{
+				DrawDebugPath(&GridPath, FColor::Red, nullptr, false, 0.1f);
+			}
 
-						// A path should have at least two points to be valid.
-						if (Result.Path->GetPathPoints().Num() < 2)
-						{
-							Result.Path->GetPathPoints().Add(FNavPathPoint(PrevNodeLocation));
-						}
+			// Mark the path as ready.
+			GridPath.MarkReady();
+			break;
+		}
+		}
+	}
 
-						break;
-					}
+	if (bShowDebugText && bShowDebug)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 0.1f, FColor::Green, FString::Printf(TEXT("FindPath cost: %f"), TraversalCost));
+	}
 
-					FVector PathNodeLocation = NavMesh->NodeRefToLocation(PathNode.NodeRef);
-					Result.Path->GetPathPoints().Add(FNavPathPoint(PathNodeLocation));
+	return Result;
+}
 
-					TraversalCost = PathNode.TraversalCost;
-					PrevNodeLocation = PathNodeLocation;
-				}
+uint32 AAmGridNavMesh::FindPathAsync(const FPathFindingQuery& Query, const FNavPathQueryDelegate& ResultDelegate)
+{
+	check(IsInGameThread());
 
-				if (NavMesh->bDrawDebugShapes)
-				{
-					Self->DrawDebugPath(Result.Path.Get(), FColor::Red, nullptr, false, 0.1f);
-				}
+	FAsyncPathQuery& PathQuery = PendingPathQueries.AddDefaulted_GetRef();
+	PathQuery.QueryId = NextPathQueryId++;
+	PathQuery.Query = Query;
+	PathQuery.ResultDelegate = ResultDelegate;
 
-				// Mark the path as ready.
-				Result.Path->MarkReady();
-				break;
+	return PathQuery.QueryId;
+}
+
+void AAmGridNavMesh::DispatchAsyncPathQueries()
+{
+	PathBatchTasks.RemoveAll([](const FGraphEventRef& Task)
+	{
+		return Task->IsComplete();
+	});
+
+	if (PendingPathQueries.Num() == 0)
+	{
+		return;
+	}
+
+	TSharedPtr<const FAmGridData, ESPMode::ThreadSafe> Snapshot = GetGridSnapshot();
+	if (!Snapshot.IsValid())
+	{
+		// Both snapshots are still read by earlier batches, try again next frame.
+		return;
+	}
+
+	auto Batch = MakeShared<TArray<FAsyncPathQuery>, ESPMode::ThreadSafe>(MoveTemp(PendingPathQueries));
+	PendingPathQueries.Reset();
+
+	const float LocationZ = GetActorLocation().Z;
+
+	// Everything that touches actors is resolved here, on the game thread.
+	for (FAsyncPathQuery& PathQuery : *Batch)
+	{
+		FNavigationPath* NavPath = PathQuery.Query.PathInstanceToFill.Get();
+		if (NavPath && NavPath->CastPath<FAmGridPath>())
+		{
+			PathQuery.Path = PathQuery.Query.PathInstanceToFill;
+			NavPath->ResetForRepath();
+		}
+		else
+		{
+			PathQuery.Path = CreatePathInstance<FAmGridPath>(PathQuery.Query);
+		}
+
+		const FNavigationQueryFilter* NavFilter = PathQuery.Query.QueryFilter.Get();
+		if (NavFilter && NavFilter->GetImplementation())
+		{
+			FAmGridQueryFilter& QueryFilter = PathQuery.QueryFilter.Emplace(*static_cast<const FAmGridQueryFilter*>(NavFilter->GetImplementation()));
+			QueryFilter.SetSpeedMultiplier(GetSpeedMultiplier(Cast<const AActor>(PathQuery.Query.Owner)));
+			QueryFilter.SetGrid(Snapshot.Get());
+			QueryFilter.SetDrawDebugShapes(false);
+		}
+	}
+
+	PathBatchTasks.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([this, Batch, Snapshot, LocationZ]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_Grid_Navigation_Pathfinding);
+
+		for (FAsyncPathQuery& PathQuery : *Batch)
+		{
+			FAmGridPath* GridPath = PathQuery.Path.IsValid() ? PathQuery.Path->CastPath<FAmGridPath>() : nullptr;
+			if (GridPath && PathQuery.QueryFilter.IsSet())
+			{
+				// No querier, the incremental search state can only be used on the game thread.
+				PathQuery.Result = FillPath(PathQuery.Query.StartLocation, PathQuery.Query.EndLocation, LocationZ, PathQuery.QueryFilter.GetValue(), *GridPath, nullptr);
 			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Batch]()
+		{
+			for (FAsyncPathQuery& PathQuery : *Batch)
+			{
+				PathQuery.ResultDelegate.ExecuteIfBound(PathQuery.QueryId, PathQuery.Result, PathQuery.Path);
 			}
+		});
+	}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask));
+}
+
+TSharedPtr<const FAmGridData, ESPMode::ThreadSafe> AAmGridNavMesh::GetGridSnapshot()
+{
+	// Snapshots are immutable, so an up to date one can be shared by several batches.
+	for (const TSharedPtr<FAmGridData, ESPMode::ThreadSafe>& Snapshot : GridSnapshots)
+	{
+		if (Snapshot.IsValid() && Snapshot->GetChangeCount() == Grid.GetChangeCount() && Snapshot->GetTime() == Grid.GetTime())
+		{
+			return Snapshot;
 		}
 	}
 
-	if (NavMesh->bShowDebugText)
+	// Otherwise overwrite a buffer no batch reads anymore.
+	for (TSharedPtr<FAmGridData, ESPMode::ThreadSafe>& Snapshot : GridSnapshots)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 0.1f, FColor::Green, FString::Printf(TEXT("FindPath cost: %f"), TraversalCost));
+		if (!Snapshot.IsValid())
+		{
+			Snapshot = MakeShared<FAmGridData, ESPMode::ThreadSafe>(Grid);
+			return Snapshot;
+		}
+
+		if (Snapshot.IsUnique())
+		{
+			*Snapshot = Grid;
+			return Snapshot;
+		}
 	}
 
-	return Result;
+	return nullptr;
 }
 
 bool AAmGridNavMesh::TestPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query, int32* NumVisitedNodes)
@@ -259,11 +562,13 @@ bool AAmGridNavMesh::TestPath(const FNavAgentProperties& AgentProperties, const
 		const FVector AdjustedEndLocation = NavFilter->GetAdjustedEndLocation(Query.EndLocation);
 		if ((Query.StartLocation - AdjustedEndLocation).IsNearlyZero() == false)
 		{
-			FGridGraphAStar Pathfinder(*NavMesh);
-			const auto* GridQueryFilter = static_cast<const FAmGridQueryFilter*>(NavFilter->GetImplementation());
-			GridQueryFilter->SetSpeedMultiplier(GetSpeedMultiplier(Cast<const AActor>(Query.Owner)));
-			FResultPathNodes PathNodes;
-			EGraphAStarResult AStarResult = Pathfinder.FindPath(StartNodeRef, EndNodeRef, *GridQueryFilter, PathNodes);
+			// Each query gets its own copy of the filter, so concurrent queries don't share the speed multiplier.
+			FAmGridQueryFilter QueryFilter(*static_cast<const FAmGridQueryFilter*>(NavFilter->GetImplementation()));
+			QueryFilter.SetSpeedMultiplier(GetSpeedMultiplier(Cast<const AActor>(Query.Owner)));
+			static thread_local FResultPathNodes PathNodes;
+			PathNodes.Reset();
+			PathNodes.bIsPartial = false;
+			EGraphAStarResult AStarResult = NavMesh->FindPathNodes(StartNodeRef, EndNodeRef, QueryFilter, PathNodes);
 
 			switch (AStarResult)
 			{
@@ -327,48 +632,24 @@ void AAmGridNavMesh::BatchProjectPoints(TArray<FNavigationProjectionWork>& Workl
 
 bool AAmGridNavMesh::IsValidRef(FNodeRef NodeRef) const
 {
-	int32 X = NodeRef % Columns;
-	int32 Y = NodeRef / Columns;
-	return X != 0 && Y != 0 && (Y % 2 == 1 || X % 2 == 1) && NodeRef >= 0 && NodeRef < TileCosts.Num();
-}
-
-FNodeRef AAmGridNavMesh::GetNeighbour(const FSearchNode& SearchNodeRef, const int32 NeighbourIndex) const
-{
-	FNodeRef NodeRef = SearchNodeRef.NodeRef;
-	FIntVector NeighbourLocationTiles;
-	NeighbourLocationTiles.X = NodeRef % Columns;
-	NeighbourLocationTiles.Y = NodeRef / Columns;
-
-	switch (NeighbourIndex)
-	{
-	case 0:
-		NeighbourLocationTiles.X--;
-		break;
-	case 1:
-		NeighbourLocationTiles.X++;
-		break;
-	case 2:
-		NeighbourLocationTiles.Y--;
-		break;
-	case 3:
-		NeighbourLocationTiles.Y++;
-		break;
-	}
-
-	return NeighbourLocationTiles.Y * Columns + NeighbourLocationTiles.X;
+	return Grid.IsValidIndex(NodeRef) && Grid.IsWalkable(NodeRef);
 }
 
 int32 AAmGridNavMesh::GetNeighbourCount(FNodeRef NodeRef) const
 {
-	return 4;
+	// Walls are excluded when the grid is initialized, so only walkable neighbours are iterated.
+	int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+	INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+	INC_DWORD_STAT_BY(STAT_Grid_Navigation_NeighboursVisited, NeighbourCount);
+	return NeighbourCount;
 }
 
 int64 AAmGridNavMesh::GetTileCost(FVector Location) const
 {
 	FNodeRef NodeRef = LocationToNodeRef(Location);
-	if (TileCosts.IsValidIndex(NodeRef))
+	if (Grid.IsValidIndex(NodeRef))
 	{
-		return TileCosts[NodeRef];
+		return Grid.GetCost(NodeRef);
 	}
 	else
 	{
@@ -379,18 +660,24 @@ int64 AAmGridNavMesh::GetTileCost(FVector Location) const
 void AAmGridNavMesh::SetTileCost(FVector Location, int64 Cost)
 {
 	FNodeRef NodeRef = LocationToNodeRef(Location);
-	if (TileCosts.IsValidIndex(NodeRef))
+	if (Grid.IsValidIndex(NodeRef))
 	{
-		TileCosts[NodeRef] = Cost;
+		const uint64 GridChangeCount = Grid.GetChangeCount();
+		Grid.SetCost(NodeRef, Cost);
+
+		if (Grid.GetChangeCount() != GridChangeCount)
+		{
+			MarkPathWatchesDirty(NodeRef);
+		}
 	}
 }
 
 float AAmGridNavMesh::GetTileTimeout(FVector Location) const
 {
 	FNodeRef NodeRef = LocationToNodeRef(Location);
-	if (TileTimeouts.IsValidIndex(NodeRef))
+	if (Grid.IsValidIndex(NodeRef))
 	{
-		return TileTimeouts[NodeRef];
+		return Grid.GetTimeout(NodeRef);
 	}
 	else
 	{
@@ -398,12 +685,17 @@ float AAmGridNavMesh::GetTileTimeout(FVector Location) const
 	}
 }
 
-void AAmGridNavMesh::SetTileTimeout(FVector Location, float Timeout)
+void AAmGridNavMesh::SetNodeDangerIntervals(FNodeRef NodeRef, TArrayView<const FAmGridDangerInterval> Intervals)
 {
-	FNodeRef NodeRef = LocationToNodeRef(Location);
-	if (TileTimeouts.IsValidIndex(NodeRef))
+	if (Grid.IsValidIndex(NodeRef))
 	{
-		TileTimeouts[NodeRef] = Timeout;
+		const uint64 GridChangeCount = Grid.GetChangeCount();
+		Grid.SetDangerIntervals(NodeRef, Intervals);
+
+		if (Grid.GetChangeCount() != GridChangeCount)
+		{
+			MarkPathWatchesDirty(NodeRef);
+		}
 	}
 }
 
@@ -411,15 +703,10 @@ bool AAmGridNavMesh::IsTileDangerous(FVector Location, float TimeBeforeTileMin,
 {
 	bool bIsDangerous = false;
 
-	float TileTimeout = GetTileTimeout(Location);
-
-	if (TileTimeout != TIMEOUT_UNSET)
+	FNodeRef NodeRef = LocationToNodeRef(Location);
+	if (Grid.IsValidIndex(NodeRef))
 	{
-		// Check if tile explodes while we run through it.
-		if (TimeBeforeTileMin <= TileTimeout && TileTimeout <= TimeAfterTileMax)
-		{
-			bIsDangerous = true;
-		}
+		bIsDangerous = Grid.IsDangerous(NodeRef, TimeBeforeTileMin, TimeAfterTileMax);
 	}
 
 	return bIsDangerous;
@@ -444,20 +731,26 @@ bool AAmGridNavMesh::IsPathSafe(AController* Controller, const TArray<FVector>&
 		return true;
 	}
 
+	TArray<FNodeRef> PathNodeRefs;
+	GetPathNodeRefs(PathPoints, PathNodeRefs);
+
+	return IsPathNodesSafe(Controller, PathNodeRefs);
+}
+
+bool AAmGridNavMesh::IsPathNodesSafe(AController* Controller, const TArray<FNodeRef>& PathNodeRefs, float* OutNextCheckTime) const
+{
 	bool bIsSafe = true;
 
 	FAmGridQueryFilter QueryFilter(this, GetSpeedMultiplier(Controller), bDrawDebugShapes);
-	FNodeRef CharacterNodeRef = LocationToNodeRef(CharacterLocation);
+	FNodeRef CharacterNodeRef = LocationToNodeRef(Controller->GetPawn()->GetActorLocation());
 	int64 TraversalCost = 0;
 	bool bFoundCurrentTile = false;
 
-	for (uint64 Index = 0; Index + 1 < PathPoints.Num(); Index++)
+	for (int32 Index = 0; Index + 1 < PathNodeRefs.Num(); Index++)
 	{
-		FVector StartLocation = PathPoints[Index];
-		FNodeRef StartNodeRef = LocationToNodeRef(StartLocation);
-
-		FVector EndLocation = PathPoints[Index + 1];
-		FNodeRef EndNodeRef = LocationToNodeRef(EndLocation);
+		FNodeRef StartNodeRef = PathNodeRefs[Index];
+		FNodeRef EndNodeRef = PathNodeRefs[Index + 1];
+		FVector StartLocation = NodeRefToLocation(StartNodeRef);
 
 		if (CharacterNodeRef == StartNodeRef)
 		{
@@ -481,18 +774,20 @@ bool AAmGridNavMesh::IsPathSafe(AController* Controller, const TArray<FVector>&
 
 		if (QueryFilter.IsTraversalAllowed(StartNodeRef, EndNodeRef))
 		{
-			FSearchNode StartSearchNode(StartNodeRef);
-			StartSearchNode.TraversalCost = TraversalCost;
-
-			FSearchNode EndSearchNode(EndNodeRef);
-
-			TraversalCost += QueryFilter.GetTraversalCost(StartSearchNode, EndSearchNode);
+			const int64 StartTraversalCost = TraversalCost;
+			TraversalCost += QueryFilter.GetNodeTraversalCost(TraversalCost, EndNodeRef);
 
 			if (TraversalCost >= ETileNavCost::BOMB)
 			{
 				bIsSafe = false;
 				break;
 			}
+
+			// Passing times only depend on the tiles before, which are all safe here.
+			if (OutNextCheckTime)
+			{
+				*OutNextCheckTime = FMath::Min(*OutNextCheckTime, QueryFilter.GetNodeDangerChangeTime(StartTraversalCost, EndNodeRef));
+			}
 		}
 		else
 		{
@@ -504,92 +799,491 @@ bool AAmGridNavMesh::IsPathSafe(AController* Controller, const TArray<FVector>&
 	return bIsSafe;
 }
 
-FVector AAmGridNavMesh::FindNearestCharacter(AController* Controller) const
+void AAmGridNavMesh::GetPathNodeRefs(const TArray<FVector>& PathPoints, TArray<FNodeRef>& OutNodeRefs) const
 {
-	TSet<FNodeRef> CharacterNodeRefs;
+	OutNodeRefs.Reset();
 
-	TArray<AActor*> Actors;
-	UGameplayStatics::GetAllActorsOfClass(this, AAmMainPlayerCharacter::StaticClass(), Actors);
-	for (AActor* Actor : Actors)
+	if (PathPoints.IsEmpty())
 	{
-		if (Controller->GetPawn() != Actor)
-		{
-			FVector ActorLocation = FAmUtils::RoundToUnitCenter(Actor->GetActorLocation());
-			FNodeRef ActorNodeRef = LocationToNodeRef(ActorLocation);
-			CharacterNodeRefs.Add(ActorNodeRef);
-		}
+		return;
 	}
 
-	FNodeDescription StartNode{ LocationToNodeRef(Controller->GetPawn()->GetActorLocation()), 0 };
+	FNodeRef NodeRef = LocationToNodeRef(PathPoints[0]);
+	OutNodeRefs.Add(NodeRef);
 
-	FNodeRef CharacterNodeRef = StartNode.NodeRef;
-	float BestCost = TNumericLimits<float>::Max();
-
-	auto CheckNearest = [this, &CharacterNodeRefs, &BestCost, &CharacterNodeRef](const FNodeDescription& CurrentNode) -> bool
+	for (int32 Index = 1; Index < PathPoints.Num(); Index++)
 	{
-		bool bContinue = true;
-		if (CharacterNodeRefs.Contains(CurrentNode.NodeRef) && CurrentNode.TraversalCost < BestCost)
+		const FNodeRef SegmentEndNodeRef = LocationToNodeRef(PathPoints[Index]);
+
+		// Grid paths only keep the points where they turn, so a segment is walked tile by tile.
+		const int32 DeltaX = SegmentEndNodeRef % Columns - NodeRef % Columns;
+		const int32 DeltaY = SegmentEndNodeRef / Columns - NodeRef / Columns;
+
+		int32 Offset = SegmentEndNodeRef - NodeRef;
+		if (DeltaY == 0)
 		{
-			BestCost = CurrentNode.TraversalCost;
-			CharacterNodeRef = CurrentNode.NodeRef;
-			bContinue = false;
+			Offset = FMath::Sign(DeltaX);
+		}
+		else if (DeltaX == 0)
+		{
+			Offset = FMath::Sign(DeltaY) * Columns;
 		}
-		return bContinue;
-	};
-
-	BFS(Controller, StartNode, CheckNearest, ETileNavCost::BLOCK);
 
-	FVector CharacterLocation = NodeRefToLocation(CharacterNodeRef);
-	CharacterLocation.Z = GetActorLocation().Z;
-	return CharacterLocation;
+		while (NodeRef != SegmentEndNodeRef)
+		{
+			NodeRef += Offset;
+			OutNodeRefs.Add(NodeRef);
+		}
+	}
 }
 
-bool AAmGridNavMesh::IsCharacterNearby(AController* Controller, int64 RadiusTiles) const
+bool AAmGridNavMesh::WatchPath(AController* Controller, const TArray<FVector>& PathPoints)
 {
-	TSet<FNodeRef> CharacterNodeRefs;
-
-	TArray<AActor*> Actors;
-	UGameplayStatics::GetAllActorsOfClass(this, AAmMainPlayerCharacter::StaticClass(), Actors);
-	for (AActor* Actor : Actors)
+	if (Controller == nullptr)
 	{
-		if (Controller->GetPawn() != Actor)
-		{
-			FVector ActorLocation = FAmUtils::RoundToUnitCenter(Actor->GetActorLocation());
-			FNodeRef ActorNodeRef = LocationToNodeRef(ActorLocation);
-			CharacterNodeRefs.Add(ActorNodeRef);
-		}
+		return false;
 	}
 
-	FNodeDescription StartNode{ LocationToNodeRef(Controller->GetPawn()->GetActorLocation()), 0 };
-
-	bool bIsNearby = false;
-
-	auto CheckNearest = [this, &CharacterNodeRefs, &bIsNearby, RadiusTiles](const FNodeDescription& CurrentNode) -> bool
+	int32 Index = PathWatches.IndexOfByPredicate([Controller](const FPathWatch& PathWatch)
 	{
-		bool bContinue = true;
+		return PathWatch.Controller == Controller;
+	});
 
-		int64 TilesCount = CurrentNode.TraversalCost / ETileNavCost::DEFAULT;
-		if (TilesCount > RadiusTiles)
+	if (Index == INDEX_NONE)
+	{
+		if (PathWatches.Num() >= MAX_PATH_WATCHES)
 		{
-			bContinue = false;
-			return bContinue;
+			UE_LOG(LogGame, Warning, TEXT("Too many watched paths, %s's path is not watched!"), *Controller->GetName());
+			return false;
 		}
 
-		if (CharacterNodeRefs.Contains(CurrentNode.NodeRef))
-		{
-			bIsNearby = true;
-			bContinue = false;
-		}
+		Index = PathWatches.AddDefaulted();
+		PathWatches[Index].Controller = Controller;
+	}
+	else
+	{
+		SetPathWatchBits(Index, false);
+	}
 
-		return bContinue;
-	};
+	FPathWatch& PathWatch = PathWatches[Index];
+	GetPathNodeRefs(PathPoints, PathWatch.NodeRefs);
+	PathWatch.bIsDirty = false;
+	UpdatePathWatchTiming(PathWatch, *Controller);
+	SetPathWatchBits(Index, true);
 
-	BFS(Controller, StartNode, CheckNearest, ETileNavCost::DEFAULT);
+	return true;
+}
+
+bool AAmGridNavMesh::UpdatePathWatchTiming(FPathWatch& PathWatch, AController& Controller) const
+{
+	PathWatch.CharacterNodeRef = LocationToNodeRef(Controller.GetPawn()->GetActorLocation());
+	PathWatch.SpeedMultiplier = GetSpeedMultiplier(&Controller);
+	PathWatch.NextCheckTime = TNumericLimits<float>::Max();
+
+	return IsPathNodesSafe(&Controller, PathWatch.NodeRefs, &PathWatch.NextCheckTime);
+}
+
+void AAmGridNavMesh::UnwatchPath(AController* Controller)
+{
+	const int32 Index = PathWatches.IndexOfByPredicate([Controller](const FPathWatch& PathWatch)
+	{
+		return PathWatch.Controller == Controller;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		RemovePathWatch(Index);
+	}
+}
+
+void AAmGridNavMesh::SetPathWatchBits(int32 Index, bool bIsSet)
+{
+	if (PathWatchMasks.Num() != Grid.Num())
+	{
+		PathWatchMasks.Init(0, Grid.Num());
+	}
+
+	const uint64 Bit = uint64(1) << Index;
+	for (FNodeRef NodeRef : PathWatches[Index].NodeRefs)
+	{
+		if (Grid.IsValidIndex(NodeRef))
+		{
+			PathWatchMasks[NodeRef] = bIsSet ? PathWatchMasks[NodeRef] | Bit : PathWatchMasks[NodeRef] & ~Bit;
+		}
+	}
+}
+
+void AAmGridNavMesh::RemovePathWatch(int32 Index)
+{
+	SetPathWatchBits(Index, false);
+
+	// The last watch takes the place of the removed one, so its bits move too.
+	const int32 LastIndex = PathWatches.Num() - 1;
+	if (Index != LastIndex)
+	{
+		SetPathWatchBits(LastIndex, false);
+		PathWatches.RemoveAtSwap(Index);
+		SetPathWatchBits(Index, true);
+	}
+	else
+	{
+		PathWatches.RemoveAt(Index);
+	}
+}
+
+void AAmGridNavMesh::MarkPathWatchesDirty(FNodeRef NodeRef)
+{
+	if (!PathWatchMasks.IsValidIndex(NodeRef) || PathWatchMasks[NodeRef] == 0)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < PathWatches.Num(); Index++)
+	{
+		if (PathWatchMasks[NodeRef] & (uint64(1) << Index))
+		{
+			PathWatches[Index].bIsDirty = true;
+		}
+	}
+}
+
+void AAmGridNavMesh::UpdatePathWatches()
+{
+	TArray<AController*, TInlineAllocator<FAmUtils::MaxPlayers>> UnsafeControllers;
+
+	for (int32 Index = PathWatches.Num() - 1; Index >= 0; Index--)
+	{
+		FPathWatch& PathWatch = PathWatches[Index];
+
+		AController* Controller = PathWatch.Controller.Get();
+		if (Controller == nullptr || Controller->GetPawn() == nullptr)
+		{
+			RemovePathWatch(Index);
+			continue;
+		}
+
+		// Danger intervals are absolute, so without tile changes the verdict only changes at the next check time or once the character moves on.
+		if (!PathWatch.bIsDirty
+			&& Grid.GetTime() < PathWatch.NextCheckTime
+			&& PathWatch.CharacterNodeRef == LocationToNodeRef(Controller->GetPawn()->GetActorLocation())
+			&& PathWatch.SpeedMultiplier == GetSpeedMultiplier(Controller))
+		{
+			continue;
+		}
+
+		PathWatch.bIsDirty = false;
+
+		// A path is reported once, the controller watches its next path again.
+		if (!UpdatePathWatchTiming(PathWatch, *Controller))
+		{
+			RemovePathWatch(Index);
+			UnsafeControllers.Add(Controller);
+		}
+	}
+
+	// Handlers may watch new paths, so they are only called once the watches are consistent.
+	for (AController* Controller : UnsafeControllers)
+	{
+		OnPathUnsafe.Broadcast(Controller);
+	}
+}
+
+FVector AAmGridNavMesh::FindNearestCharacter(AController* Controller) const
+{
+	FNodeRef CharacterNodeRef = LocationToNodeRef(Controller->GetPawn()->GetActorLocation());
+
+	if (const FCharacterFieldEntry* Entry = FindNearestCharacterEntry(Controller))
+	{
+		CharacterNodeRef = CharacterTiles[Entry->CharacterIndex].NodeRef;
+	}
+
+	FVector CharacterLocation = NodeRefToLocation(CharacterNodeRef);
+	CharacterLocation.Z = GetActorLocation().Z;
+	return CharacterLocation;
+}
+
+bool AAmGridNavMesh::IsCharacterNearby(AController* Controller, int64 RadiusTiles) const
+{
+	const FCharacterFieldEntry* Entry = FindNearestCharacterEntry(Controller);
+
+	// The nearest character is only reachable through plain tiles if it costs less than a single block.
+	return Entry && Entry->TraversalCost < ETileNavCost::BLOCK && Entry->TraversalCost / ETileNavCost::DEFAULT <= RadiusTiles;
+}
+
+EGraphAStarResult AAmGridNavMesh::FindPathNodes(FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& InQueryFilter, FResultPathNodes& OutPathNodes, const UObject* Querier) const
+{
+	EGraphAStarResult Result;
+
+	// FindPath and TestPath may be called on any thread, state kept next to the nav mesh grid is only touched on the game thread.
+	const bool bIsGameThread = IsInGameThread();
+
+	// The landmark tables are updated on the game thread, other threads fall back to the Manhattan distance.
+	TOptional<FAmGridQueryFilter> WorkerQueryFilter;
+	if (!bIsGameThread && InQueryFilter.UsesLandmarks())
+	{
+		WorkerQueryFilter.Emplace(InQueryFilter);
+		WorkerQueryFilter->DisableLandmarks();
+	}
+	const FAmGridQueryFilter& QueryFilter = WorkerQueryFilter.IsSet() ? WorkerQueryFilter.GetValue() : InQueryFilter;
+
+	// Either the nav mesh grid or a snapshot of it.
+	const FAmGridData& SearchGrid = QueryFilter.GetGrid();
+
+	if (&SearchGrid == &Grid)
+	{
+		// Skip the search entirely if bombs split the start and the goal apart, an unreachable goal is not turned into a path anyway.
+		if (bIsGameThread && IsValidRef(StartNodeRef) && IsValidRef(EndNodeRef) && !AreNodesConnected(StartNodeRef, EndNodeRef, true))
+		{
+			return GoalUnreachable;
+		}
+
+		// Bots poll the same queries while nothing around the path changes.
+		if (bIsGameThread && PathCacheSize > 0)
+		{
+			if (const FCachedPath* CachedPath = FindCachedPath(StartNodeRef, EndNodeRef, QueryFilter.GetSpeedMultiplier()))
+			{
+				OutPathNodes = CachedPath->PathNodes;
+				return SearchSuccess;
+			}
+		}
+
+		// The query filter reads the landmarks for its heuristic, snapshot and worker filters don't.
+		if (bIsGameThread)
+		{
+			Landmarks.Update(Grid, LandmarkCount);
+		}
+	}
+
+	// Plain A*, also used for queries other modes can't handle.
+	auto FindPathAStar = [&]()
+	{
+		return GridAStar.FindPath(SearchGrid, StartNodeRef, EndNodeRef, QueryFilter, OutPathNodes);
+	};
+
+	switch (PathfindingMode)
+	{
+	case EAmGridPathfindingMode::JumpPointSearch:
+	{
+		Result = GridJumpPointSearch.FindPath(SearchGrid, StartNodeRef, EndNodeRef, QueryFilter, OutPathNodes);
+		break;
+	}
+	case EAmGridPathfindingMode::SpaceTime:
+	{
+		Result = GridSpaceTimeSearch.FindPath(SearchGrid, StartNodeRef, EndNodeRef, QueryFilter, OutPathNodes, OutPathNodes.bIsPartial);
+		break;
+	}
+	case EAmGridPathfindingMode::FlowField:
+	{
+		// Shared fields follow the nav mesh grid and are built on the game thread, other queries get a field of their own.
+		if (&SearchGrid == &Grid && bIsGameThread)
+		{
+			Result = GetFlowField(EndNodeRef).FindPath(Grid, StartNodeRef, OutPathNodes);
+		}
+		else
+		{
+			FAmGridFlowField FlowField;
+			FlowField.Build(SearchGrid, EndNodeRef, FlowFieldDangerTime);
+			Result = FlowField.FindPath(SearchGrid, StartNodeRef, OutPathNodes);
+		}
+		break;
+	}
+	case EAmGridPathfindingMode::Incremental:
+	{
+		// Only FindPath passes the querier, so TestPath and EQS queries don't reset the search the agent replans with.
+		// The search state follows the nav mesh grid, so it is not used for snapshots or off the game thread.
+		if (Querier && &SearchGrid == &Grid && bIsGameThread)
+		{
+			TSharedPtr<FAmGridIncrementalSearch>* Pathfinder = IncrementalSearches.Find(Querier);
+			if (!Pathfinder)
+			{
+				// Drop the state of queriers destroyed since.
+				for (auto It = IncrementalSearches.CreateIterator(); It; ++It)
+				{
+					if (!It.Key().IsValid())
+					{
+						It.RemoveCurrent();
+					}
+				}
+
+				Pathfinder = &IncrementalSearches.Add(Querier, MakeShared<FAmGridIncrementalSearch>(Grid));
+			}
+
+			Result = (*Pathfinder)->FindPath(StartNodeRef, EndNodeRef, QueryFilter, OutPathNodes);
+		}
+		else
+		{
+			Result = FindPathAStar();
+		}
+		break;
+	}
+	case EAmGridPathfindingMode::Hierarchical:
+	{
+		// The hierarchy follows the nav mesh grid and is updated on the game thread, so it is not used for snapshots or elsewhere.
+		// Nearby tiles are left to A*.
+		const bool bUseHierarchy = &SearchGrid == &Grid && bIsGameThread;
+		if (bUseHierarchy)
+		{
+			GridHierarchy.Update(Grid, HierarchyClusterSize);
+		}
+
+		if (bUseHierarchy && GridHierarchy.IsLongRange(StartNodeRef, EndNodeRef))
+		{
+			FAmGridHierarchy::FSearchStats SearchStats;
+			Result = GridHierarchy.FindPath(Grid, StartNodeRef, EndNodeRef, QueryFilter, OutPathNodes, SearchStats);
+		}
+		else
+		{
+			Result = FindPathAStar();
+		}
+		break;
+	}
+	case EAmGridPathfindingMode::AStar:
+	default:
+	{
+		Result = FindPathAStar();
+		break;
+	}
+	}
+
+	// Only found paths are cached, an unreachable goal may depend on tiles far from the partial path.
+	if (Result == SearchSuccess && &SearchGrid == &Grid && bIsGameThread && PathCacheSize > 0)
+	{
+		AddCachedPath(StartNodeRef, EndNodeRef, QueryFilter.GetSpeedMultiplier(), OutPathNodes);
+	}
+
+	return Result;
+}
+
+void AAmGridNavMesh::UpdatePathCache() const
+{
+	check(IsInGameThread());
+
+	if (PathCache.PathfindingMode != PathfindingMode)
+	{
+		PathCache.Entries.Reset();
+		PathCache.PathfindingMode = PathfindingMode;
+	}
+
+	const uint64 GridChangeCount = Grid.GetChangeCount();
+	if (PathCache.GridChangeCount == GridChangeCount)
+	{
+		return;
+	}
+
+	if (PathCache.Entries.Num() > 0)
+	{
+		if (!Grid.GetChangedTiles(PathCache.GridChangeCount, PathCache.ChangedTiles))
+		{
+			PathCache.Entries.Reset();
+		}
+		else
+		{
+			TBitArray<>& ChangedTileMask = PathCache.ChangedTileMask;
+			if (ChangedTileMask.Num() != Grid.Num())
+			{
+				ChangedTileMask.Init(false, Grid.Num());
+			}
+
+			for (FNodeRef NodeRef : PathCache.ChangedTiles)
+			{
+				ChangedTileMask[NodeRef] = true;
+			}
+
+			PathCache.Entries.RemoveAll([&ChangedTileMask](const FCachedPath& CachedPath)
+			{
+				return CachedPath.GuardedTiles.ContainsByPredicate([&ChangedTileMask](FNodeRef NodeRef)
+				{
+					return ChangedTileMask[NodeRef];
+				});
+			});
+
+			for (FNodeRef NodeRef : PathCache.ChangedTiles)
+			{
+				ChangedTileMask[NodeRef] = false;
+			}
+		}
+	}
+
+	PathCache.GridChangeCount = GridChangeCount;
+}
+
+int32 AAmGridNavMesh::GetPathCacheSpeedClass(float SpeedMultiplier)
+{
+	// Quarter steps, traversal costs of close speeds differ too little to matter.
+	return FMath::RoundToInt(SpeedMultiplier * 4.f);
+}
+
+const AAmGridNavMesh::FCachedPath* AAmGridNavMesh::FindCachedPath(FNodeRef StartNodeRef, FNodeRef EndNodeRef, float SpeedMultiplier) const
+{
+	UpdatePathCache();
+
+	const int32 SpeedClass = GetPathCacheSpeedClass(SpeedMultiplier);
+
+	const int32 Index = PathCache.Entries.IndexOfByPredicate([StartNodeRef, EndNodeRef, SpeedClass](const FCachedPath& CachedPath)
+	{
+		return CachedPath.StartNodeRef == StartNodeRef && CachedPath.EndNodeRef == EndNodeRef && CachedPath.SpeedClass == SpeedClass;
+	});
+
+	if (Index == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_Grid_Navigation_PathCacheMisses);
+		return nullptr;
+	}
+
+	INC_DWORD_STAT(STAT_Grid_Navigation_PathCacheHits);
 
-	return bIsNearby;
+	// Move the entry to the most recently used end.
+	FCachedPath CachedPath = MoveTemp(PathCache.Entries[Index]);
+	PathCache.Entries.RemoveAt(Index, 1, false);
+	return &PathCache.Entries.Add_GetRef(MoveTemp(CachedPath));
 }
 
-void AAmGridNavMesh::BFS(AController* Controller, const FNodeDescription& StartNode, std::function<bool(const FNodeDescription& CurrentNode)> NodeRefFunc, ETileNavCost::Type MaxTileNavCostAllowed) const
+void AAmGridNavMesh::AddCachedPath(FNodeRef StartNodeRef, FNodeRef EndNodeRef, float SpeedMultiplier, const FResultPathNodes& PathNodes) const
+{
+	UpdatePathCache();
+
+	// Whether a danger is run into depends on when the path is started, such a path is only good for now.
+	if (Grid.HasTimeout(StartNodeRef) || PathNodes.ContainsByPredicate([this](const FNodeDescription& PathNode) { return Grid.HasTimeout(PathNode.NodeRef); }))
+	{
+		return;
+	}
+
+	// Evict the least recently used entries, the buffers of the last one are reused.
+	FCachedPath CachedPath;
+	while (PathCache.Entries.Num() >= PathCacheSize)
+	{
+		CachedPath = MoveTemp(PathCache.Entries[0]);
+		PathCache.Entries.RemoveAt(0, 1, false);
+	}
+
+	CachedPath.StartNodeRef = StartNodeRef;
+	CachedPath.EndNodeRef = EndNodeRef;
+	CachedPath.SpeedClass = GetPathCacheSpeedClass(SpeedMultiplier);
+	CachedPath.PathNodes = PathNodes;
+
+	CachedPath.GuardedTiles.Reset();
+	auto GuardTile = [this, &CachedPath](FNodeRef NodeRef)
+	{
+		CachedPath.GuardedTiles.Add(NodeRef);
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			CachedPath.GuardedTiles.Add(Grid.GetNeighbour(NodeRef, NeighbourIdx));
+		}
+	};
+
+	GuardTile(StartNodeRef);
+	for (const FNodeDescription& PathNode : PathNodes)
+	{
+		GuardTile(PathNode.NodeRef);
+	}
+
+	PathCache.Entries.Add(MoveTemp(CachedPath));
+}
+
+template<typename TVisitor>
+void AAmGridNavMesh::Dijkstra(AController* Controller, const FNodeDescription& StartNode, TVisitor&& Visitor, ETileNavCost::Type MaxTileNavCostAllowed) const
 {
 	if (!IsValidRef(StartNode.NodeRef))
 	{
@@ -599,58 +1293,63 @@ void AAmGridNavMesh::BFS(AController* Controller, const FNodeDescription& StartN
 
 	FAmGridQueryFilter QueryFilter(this, GetSpeedMultiplier(Controller), bDrawDebugShapes);
 
-	TArray<int64> VisitedCost;
-	VisitedCost.Init(TNumericLimits<int64>::Max(), Columns * Rows);
-	VisitedCost[StartNode.NodeRef] = 0;
-
-	// Create a queue for BFS
-	TQueue<FNodeDescription> Queue;
-	Queue.Enqueue(StartNode);
+	FGridSearchScratch& Scratch = GridSearchScratch;
+	Scratch.Begin(Grid.Num());
+	Scratch.SetVisitedCost(StartNode.NodeRef, StartNode.TraversalCost);
+	Scratch.OpenList.Push(StartNode);
 
-	while (!Queue.IsEmpty())
+	while (!Scratch.OpenList.IsEmpty())
 	{
-		FNodeDescription CurrentNode;
-		Queue.Dequeue(CurrentNode);
+		FNodeDescription CurrentNode = Scratch.OpenList.Pop();
 
-		if (!NodeRefFunc(CurrentNode))
+		// Skip entries of tiles that have been reached cheaper since they were pushed.
+		if (CurrentNode.TraversalCost > Scratch.GetVisitedCost(CurrentNode.NodeRef))
 		{
-			return;
+			continue;
 		}
 
-		FSearchNode CurrentSearchNode(CurrentNode.NodeRef);
-		CurrentSearchNode.TraversalCost = CurrentNode.TraversalCost;
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesSettled);
 
-		for (int32 NeighbourIdx = 0; NeighbourIdx < GetNeighbourCount(CurrentSearchNode.NodeRef); NeighbourIdx++)
+		if (!Visitor(CurrentNode))
 		{
-			FNodeRef NeighbourNodeRef = GetNeighbour(CurrentSearchNode, NeighbourIdx);
-			if (IsValidRef(NeighbourNodeRef))
+			return;
+		}
+
+		const int32 NeighbourCount = GetNeighbourCount(CurrentNode.NodeRef);
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			FNodeRef NeighbourNodeRef = Grid.GetNeighbour(CurrentNode.NodeRef, NeighbourIdx);
+
+			int64 NeighbourCost = QueryFilter.GetNodeTraversalCost(CurrentNode.TraversalCost, NeighbourNodeRef);
+			int64 NeighbourTraversalCost = CurrentNode.TraversalCost + NeighbourCost;
+
+			if (Scratch.GetVisitedCost(NeighbourNodeRef) > NeighbourTraversalCost &&
+				QueryFilter.IsTraversalAllowed(CurrentNode.NodeRef, NeighbourNodeRef) &&
+				NeighbourCost <= MaxTileNavCostAllowed)
 			{
-				FSearchNode NeighbourSearchNode(NeighbourNodeRef);
-				FVector NeighbourLocation = NodeRefToLocation(NeighbourNodeRef);
-				float NeighbourCost = QueryFilter.GetTraversalCost(CurrentSearchNode, NeighbourSearchNode);
-				float NeighbourTraversalCost = CurrentSearchNode.TraversalCost + NeighbourCost;
-
-				if (VisitedCost.IsValidIndex(NeighbourNodeRef) &&
-					VisitedCost[NeighbourNodeRef] > NeighbourTraversalCost &&
-					QueryFilter.IsTraversalAllowed(CurrentSearchNode.NodeRef, NeighbourNodeRef) &&
-					NeighbourCost <= MaxTileNavCostAllowed)
+				if (Scratch.IsVisited(NeighbourNodeRef))
 				{
-					VisitedCost[NeighbourNodeRef] = NeighbourTraversalCost;
-
-					FNodeDescription NeighbourNode{ NeighbourNodeRef, NeighbourTraversalCost };
-					Queue.Enqueue(NeighbourNode);
+					INC_DWORD_STAT(STAT_Grid_Navigation_NodesReenqueued);
 				}
+
+				Scratch.SetVisitedCost(NeighbourNodeRef, NeighbourTraversalCost);
+				Scratch.OpenList.Push({ NeighbourNodeRef, NeighbourTraversalCost });
 			}
 		}
 	}
 }
 
 FVector AAmGridNavMesh::NodeRefToLocation(FNodeRef NodeRef) const
+{
+	return NodeRefToLocation(NodeRef, GetActorLocation().Z);
+}
+
+FVector AAmGridNavMesh::NodeRefToLocation(FNodeRef NodeRef, float LocationZ) const
 {
 	FVector NodeLocation;
 	NodeLocation.X = (NodeRef % Columns) * FAmUtils::Unit + FAmUtils::Unit / 2;
 	NodeLocation.Y = (NodeRef / Columns) * FAmUtils::Unit + FAmUtils::Unit / 2;
-	NodeLocation.Z = GetActorLocation().Z;
+	NodeLocation.Z = LocationZ;
 	return NodeLocation;
 }
 
@@ -665,15 +1364,196 @@ FNodeRef AAmGridNavMesh::LocationToNodeRef(FVector Location) const
 
 void AAmGridNavMesh::ResetTiles()
 {
-	for (FNodeRef NodeRef = 0; NodeRef < TileCosts.Num(); NodeRef++)
+	Grid.Reset();
+	IncrementalSearches.Reset();
+	FlowFields.Reset();
+	ReachabilityCache.Reset();
+	PathCache.Entries.Reset();
+
+	// Every tile may have changed.
+	for (FPathWatch& PathWatch : PathWatches)
 	{
-		TileCosts[NodeRef] = 1;
+		PathWatch.bIsDirty = true;
 	}
+}
 
-	for (FNodeRef NodeRef = 0; NodeRef < TileTimeouts.Num(); NodeRef++)
+bool AAmGridNavMesh::AreNodesConnected(FNodeRef StartNodeRef, FNodeRef EndNodeRef, bool bAllowBlocks) const
+{
+	check(IsInGameThread());
+
+	FAmGridConnectivity& Regions = bAllowBlocks ? PassableRegions : PlainRegions;
+	Regions.Update(Grid);
+	return Regions.IsConnected(Grid, StartNodeRef, EndNodeRef);
+}
+
+void AAmGridNavMesh::SetCharacterTile(const APawn* Character, FNodeRef NodeRef)
+{
+	int32 Index = CharacterTiles.IndexOfByPredicate([Character](const FCharacterTile& CharacterTile)
 	{
-		TileTimeouts[NodeRef] = TIMEOUT_UNSET;
+		return CharacterTile.Character == Character;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		if (Grid.IsValidIndex(CharacterTiles[Index].NodeRef))
+		{
+			Grid.RemoveOccupant(CharacterTiles[Index].NodeRef);
+		}
+
+		if (!Grid.IsValidIndex(NodeRef))
+		{
+			CharacterTiles.RemoveAtSwap(Index);
+			CharacterTilesVersion++;
+			return;
+		}
+	}
+	else if (Grid.IsValidIndex(NodeRef))
+	{
+		Index = CharacterTiles.Add({ Character, INDEX_NONE });
 	}
+	else
+	{
+		return;
+	}
+
+	CharacterTiles[Index].NodeRef = NodeRef;
+	Grid.AddOccupant(NodeRef);
+	CharacterTilesVersion++;
+}
+
+const AAmGridNavMesh::FCharacterFieldEntry* AAmGridNavMesh::FindNearestCharacterEntry(AController* Controller) const
+{
+	FNodeRef NodeRef = LocationToNodeRef(Controller->GetPawn()->GetActorLocation());
+	if (!IsValidRef(NodeRef))
+	{
+		return nullptr;
+	}
+
+	UpdateCharacterField();
+
+	const APawn* Pawn = Controller->GetPawn();
+	for (int32 EntryIndex = NodeRef * 2; EntryIndex < NodeRef * 2 + 2; EntryIndex++)
+	{
+		const FCharacterFieldEntry& Entry = CharacterField.Entries[EntryIndex];
+		if (Entry.CharacterIndex != INDEX_NONE && CharacterTiles[Entry.CharacterIndex].Character != Pawn)
+		{
+			return &Entry;
+		}
+	}
+
+	return nullptr;
+}
+
+void AAmGridNavMesh::UpdateCharacterField() const
+{
+	if (CharacterField.bIsValid &&
+		CharacterField.GridChangeCount == Grid.GetChangeCount() &&
+		CharacterField.CharacterTilesVersion == CharacterTilesVersion &&
+		CharacterField.Entries.Num() == Grid.Num() * 2)
+	{
+		return;
+	}
+
+	CharacterField.bIsValid = true;
+	CharacterField.GridChangeCount = Grid.GetChangeCount();
+	CharacterField.CharacterTilesVersion = CharacterTilesVersion;
+	CharacterField.Entries.Init(FCharacterFieldEntry(), Grid.Num() * 2);
+
+	// Open list nodes are labelled with both the tile and the character, NodeRef * CharacterCount + CharacterIndex.
+	const int32 CharacterCount = CharacterTiles.Num();
+	FGridSearchScratch& Scratch = GridSearchScratch;
+	Scratch.Begin(Grid.Num());
+
+	for (int32 CharacterIndex = 0; CharacterIndex < CharacterCount; CharacterIndex++)
+	{
+		Scratch.OpenList.Push({ CharacterTiles[CharacterIndex].NodeRef * CharacterCount + CharacterIndex, 0 });
+	}
+
+	while (!Scratch.OpenList.IsEmpty())
+	{
+		FNodeDescription CurrentNode = Scratch.OpenList.Pop();
+		FNodeRef NodeRef = CurrentNode.NodeRef / CharacterCount;
+		int32 CharacterIndex = CurrentNode.NodeRef % CharacterCount;
+
+		FCharacterFieldEntry* Entries = &CharacterField.Entries[NodeRef * 2];
+		if (Entries[0].CharacterIndex == CharacterIndex || Entries[1].CharacterIndex != INDEX_NONE)
+		{
+			continue;
+		}
+
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesSettled);
+
+		FCharacterFieldEntry& Entry = Entries[0].CharacterIndex == INDEX_NONE ? Entries[0] : Entries[1];
+		Entry.TraversalCost = CurrentNode.TraversalCost;
+		Entry.CharacterIndex = CharacterIndex;
+
+		// The field is searched backwards, paths to the character pay for the tile they step on, not the one they leave.
+		int64 TileCost = Grid.GetCost(NodeRef);
+		if (TileCost > ETileNavCost::BLOCK)
+		{
+			continue;
+		}
+
+		const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+		for (int32 NeighbourIdx = 0; NeighbourIdx < NeighbourCount; NeighbourIdx++)
+		{
+			INC_DWORD_STAT(STAT_Grid_Navigation_NeighboursVisited);
+
+			FNodeRef NeighbourNodeRef = Grid.GetNeighbour(NodeRef, NeighbourIdx);
+			const FCharacterFieldEntry* NeighbourEntries = &CharacterField.Entries[NeighbourNodeRef * 2];
+			if (NeighbourEntries[0].CharacterIndex != CharacterIndex && NeighbourEntries[1].CharacterIndex == INDEX_NONE)
+			{
+				Scratch.OpenList.Push({ NeighbourNodeRef * CharacterCount + CharacterIndex, CurrentNode.TraversalCost + TileCost });
+			}
+		}
+	}
+}
+
+const FAmGridFlowField& AAmGridNavMesh::GetFlowField(FNodeRef TargetNodeRef) const
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FAmGridFlowField>* FlowField = FlowFields.Find(TargetNodeRef);
+	if (!FlowField)
+	{
+		// Targets are usually characters, drop the fields nobody has asked for since the grid changed.
+		if (FlowFields.Num() >= FAmUtils::MaxPlayers * 2)
+		{
+			for (auto It = FlowFields.CreateIterator(); It; ++It)
+			{
+				if (It.Value()->GetGridChangeCount() != Grid.GetChangeCount())
+				{
+					It.RemoveCurrent();
+				}
+			}
+		}
+
+		FlowField = &FlowFields.Add(TargetNodeRef, MakeShared<FAmGridFlowField>());
+		(*FlowField)->Build(Grid, TargetNodeRef, FlowFieldDangerTime);
+	}
+	else if ((*FlowField)->GetGridChangeCount() != Grid.GetChangeCount() || (Grid.HasDangers() && (*FlowField)->GetGridTime() != Grid.GetTime()))
+	{
+		(*FlowField)->Build(Grid, TargetNodeRef, FlowFieldDangerTime);
+	}
+
+	return **FlowField;
+}
+
+FVector AAmGridNavMesh::GetFlowFieldNextLocation(FVector Location, FVector TargetLocation) const
+{
+	FNodeRef NodeRef = LocationToNodeRef(Location);
+	FNodeRef TargetNodeRef = LocationToNodeRef(TargetLocation);
+
+	if (IsValidRef(NodeRef) && IsValidRef(TargetNodeRef))
+	{
+		const FAmGridFlowField& FlowField = GetFlowField(TargetNodeRef);
+		if (FlowField.GetDirection(NodeRef) != EAmGridDirection::MAX)
+		{
+			NodeRef = Grid.GetNeighbourInDirection(NodeRef, FlowField.GetDirection(NodeRef));
+		}
+	}
+
+	return NodeRefToLocation(NodeRef);
 }
 
 void AAmGridNavMesh::GetReachableTiles(AController* Controller, TArray<float>& OutCosts, bool bAddMovementDelay) const
@@ -681,13 +1561,68 @@ void AAmGridNavMesh::GetReachableTiles(AController* Controller, TArray<float>& O
 	OutCosts.Init(TNumericLimits<float>::Max(), Columns * Rows);
 
 	int64 StartCost = bAddMovementDelay ? ETileNavCost::DEFAULT : 0;
+	const TArray<int64>& Costs = GetReachableCosts(Controller, StartCost, ETileNavCost::DEFAULT);
+
+	for (FNodeRef NodeRef = 0; NodeRef < Costs.Num() && NodeRef < OutCosts.Num(); NodeRef++)
+	{
+		if (Costs[NodeRef] != TNumericLimits<int64>::Max())
+		{
+			OutCosts[NodeRef] = Costs[NodeRef];
+		}
+	}
+}
+
+const TArray<int64>& AAmGridNavMesh::GetReachableCosts(AController* Controller, int64 StartCost, ETileNavCost::Type MaxTileNavCostAllowed) const
+{
 	FNodeDescription StartNode{ LocationToNodeRef(Controller->GetPawn()->GetActorLocation()), StartCost };
+	const float SpeedMultiplier = GetSpeedMultiplier(Controller);
 
-	auto SetOutCost = [&OutCosts](const FNodeDescription& CurrentNode) -> bool
+	auto* Entries = ReachabilityCache.Find(Controller);
+	if (!Entries)
 	{
-		OutCosts[CurrentNode.NodeRef] = CurrentNode.TraversalCost;
+		// Drop the entries of controllers destroyed since.
+		for (auto It = ReachabilityCache.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().IsValid())
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		Entries = &ReachabilityCache.Add(Controller);
+	}
+
+	FReachableCosts* Entry = Entries->FindByPredicate([StartCost, MaxTileNavCostAllowed](const FReachableCosts& Candidate)
+	{
+		return Candidate.StartCost == StartCost && Candidate.MaxTileNavCostAllowed == MaxTileNavCostAllowed;
+	});
+
+	if (!Entry)
+	{
+		Entry = &Entries->AddDefaulted_GetRef();
+		Entry->StartCost = StartCost;
+		Entry->MaxTileNavCostAllowed = MaxTileNavCostAllowed;
+	}
+	else if (Entry->StartNodeRef == StartNode.NodeRef && Entry->SpeedMultiplier == SpeedMultiplier && Entry->GridChangeCount == Grid.GetChangeCount() &&
+		(!Grid.HasDangers() || Entry->GridTime == Grid.GetTime()))
+	{
+		return Entry->Costs;
+	}
+
+	Entry->StartNodeRef = StartNode.NodeRef;
+	Entry->SpeedMultiplier = SpeedMultiplier;
+	Entry->GridChangeCount = Grid.GetChangeCount();
+	Entry->GridTime = Grid.GetTime();
+	Entry->Costs.Init(TNumericLimits<int64>::Max(), Grid.Num());
+
+	TArray<int64>& Costs = Entry->Costs;
+	auto SetCost = [&Costs](const FNodeDescription& CurrentNode) -> bool
+	{
+		Costs[CurrentNode.NodeRef] = CurrentNode.TraversalCost;
 		return true;
 	};
 
-	BFS(Controller, StartNode, SetOutCost, ETileNavCost::DEFAULT);
+	Dijkstra(Controller, StartNode, SetCost, MaxTileNavCostAllowed);
+
+	return Entry->Costs;
 }
@@ -3,16 +3,55 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
 #include "GraphAStar.h"
 #include "Navigation/NavLocalGridData.h"
-#include "NavMesh/NavMeshPath.h"
+#include "NavigationData.h"
+#include "AI/AmGridConnectivity.h"
+#include "AI/AmGridData.h"
+#include "AI/AmGridHierarchy.h"
+#include "AI/AmGridLandmarks.h"
+#include "AI/AmGridQueryFilter.h"
 #include "Game/AmUtils.h"
 
 #include "AmGridNavMesh.generated.h"
 
 DECLARE_CYCLE_STAT(TEXT("Grid A* Pathfinding"), STAT_Grid_Navigation_Pathfinding, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid neighbours visited"), STAT_Grid_Navigation_NeighboursVisited, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid nodes expanded"), STAT_Grid_Navigation_NodesExpanded, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid nodes settled"), STAT_Grid_Navigation_NodesSettled, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid nodes re-enqueued"), STAT_Grid_Navigation_NodesReenqueued, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid abstract nodes expanded"), STAT_Grid_Navigation_AbstractNodesExpanded, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid search allocations"), STAT_Grid_Navigation_SearchAllocations, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid path cache hits"), STAT_Grid_Navigation_PathCacheHits, STATGROUP_Navigation);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Grid path cache misses"), STAT_Grid_Navigation_PathCacheMisses, STATGROUP_Navigation);
 
-typedef FNavLocalGridData::FNodeRef FNodeRef;
+/**
+ * @brief Delegate executed when a tile on a watched path changes and the path is not safe anymore.
+ * @param Controller that watches the path.
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FGridPathUnsafe, AController*, Controller);
+
+class FAmGridIncrementalSearch;
+class FAmGridFlowField;
+struct FAmGridPath;
+
+UENUM()
+enum class EAmGridPathfindingMode : uint8
+{
+	// Plain A* that expands every tile.
+	AStar,
+	// A* that jumps over runs of plain tiles (Jump Point Search).
+	JumpPointSearch,
+	// Per-agent Lifelong Planning A* that only repairs the search around changed tiles.
+	Incremental,
+	// A* over (tile, time) states that waits for explosions to pass instead of estimating the danger.
+	SpaceTime,
+	// Flow field shared by every agent heading to the same tile, the path just follows its directions.
+	FlowField,
+	// Search over precomputed cluster entrances refined inside the clusters (HPA*), for long range queries on large arenas.
+	Hierarchical,
+};
 
 /**
  * AAmGridNavMesh class contains methods for finding or testing a navigation path using A* algorithm.
@@ -22,27 +61,138 @@ class AAmGridNavMesh : public ANavigationData
 {
 	GENERATED_BODY()
 
-	typedef FGraphAStarDefaultNode<AAmGridNavMesh> FSearchNode;
+	typedef FAmGridPathNode FNodeDescription;
+
+	// Traversal costs of every tile reachable from a start tile, along with what they were computed for.
+	struct FReachableCosts
+	{
+		FNodeRef StartNodeRef = INDEX_NONE;
+
+		int64 StartCost = 0;
+
+		float SpeedMultiplier = 0.f;
+
+		ETileNavCost::Type MaxTileNavCostAllowed = ETileNavCost::DEFAULT;
+
+		uint64 GridChangeCount = 0;
+
+		float GridTime = 0.f;
+
+		TArray<int64> Costs;
+	};
+
+	struct FAsyncPathQuery
+	{
+		uint32 QueryId = 0;
+
+		FPathFindingQuery Query;
+
+		FNavPathQueryDelegate ResultDelegate;
+
+		/* Filled when the batch is dispatched. */
+
+		TOptional<FAmGridQueryFilter> QueryFilter;
+
+		FNavPathSharedPtr Path;
+
+		ENavigationQueryResult::Type Result = ENavigationQueryResult::Error;
+	};
+
+	// Path registered by WatchPath, checked again when a tile on it changes or its verdict may change with time.
+	struct FPathWatch
+	{
+		TWeakObjectPtr<AController> Controller;
+
+		TArray<FNodeRef> NodeRefs;
+
+		// The walk on the path is timed from the character's tile with its speed.
+		FNodeRef CharacterNodeRef = INDEX_NONE;
+
+		float SpeedMultiplier = 1.f;
+
+		// World time a danger interval starts overlapping the time the character passes a tile.
+		float NextCheckTime = TNumericLimits<float>::Max();
+
+		bool bIsDirty = false;
+	};
+
+	struct FCharacterTile
+	{
+		TWeakObjectPtr<const APawn> Character;
+
+		FNodeRef NodeRef = INDEX_NONE;
+	};
+
+	// Character reaching a tile the cheapest way, CharacterIndex indexes CharacterTiles.
+	struct FCharacterFieldEntry
+	{
+		int64 TraversalCost = TNumericLimits<int64>::Max();
+
+		int32 CharacterIndex = INDEX_NONE;
+	};
 
-	struct FNodeDescription
+	/**
+	 * Two nearest characters of every tile, so every character can look up its nearest other character.
+	 * Built by a single multi-source Dijkstra for all characters, entries are ordered by traversal cost.
+	 */
+	struct FCharacterField
 	{
-		FNodeRef NodeRef;
-		int64 TraversalCost;
+		uint64 GridChangeCount = 0;
+
+		uint32 CharacterTilesVersion = 0;
+
+		bool bIsValid = false;
+
+		// Entries of NodeRef are at NodeRef * 2 and NodeRef * 2 + 1.
+		TArray<FCharacterFieldEntry> Entries;
 	};
 
 	struct FResultPathNodes : TArray<FNodeDescription>
 	{
-		FNodeRef SetPathInfo(const int32 Index, const FSearchNode& SearchNode)
-		{
-			GetData()[Index].NodeRef = SearchNode.NodeRef;
-			GetData()[Index].TraversalCost = SearchNode.TraversalCost;
-			return -1;
-		}
+		// Set when the path intentionally stops short of the goal, e.g. to wait for an explosion to pass.
+		bool bIsPartial = false;
+	};
+
+	// Path found for a query, kept until a tile on or next to it changes.
+	struct FCachedPath
+	{
+		FNodeRef StartNodeRef = INDEX_NONE;
+
+		FNodeRef EndNodeRef = INDEX_NONE;
+
+		int32 SpeedClass = 0;
+
+		FResultPathNodes PathNodes;
+
+		// Tiles of the path and their neighbours, the start tile included.
+		TArray<FNodeRef> GuardedTiles;
+	};
+
+	/**
+	 * Least recently used paths of the nav mesh grid, entries are ordered from the least to the most recently used.
+	 * Entries are checked against the tiles changed since the last lookup, so tiles changed far from a path don't drop it.
+	 */
+	struct FPathCache
+	{
+		uint64 GridChangeCount = 0;
+
+		EAmGridPathfindingMode PathfindingMode = EAmGridPathfindingMode::AStar;
+
+		TArray<FCachedPath> Entries;
+
+		/* Scratch buffers reused between lookups. */
+
+		TArray<FNodeRef> ChangedTiles;
+
+		TBitArray<> ChangedTileMask;
 	};
 
 public:
 
-	static constexpr float TIMEOUT_UNSET = TNumericLimits<float>::Lowest();
+	static constexpr float TIMEOUT_UNSET = FAmGridData::TIMEOUT_UNSET;
+
+	// Watched paths are tracked with a bit per tile.
+	static constexpr int32 MAX_PATH_WATCHES = 64;
 
 	// Type used for identification of nodes in the graph.
 	typedef FNodeRef FNodeRef;
@@ -57,6 +207,8 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 
 	/**
@@ -69,23 +221,81 @@ public:
 
 	static bool TestPath(const FNavAgentProperties& AgentProperties, const FPathFindingQuery& Query, int32* NumVisitedNodes);
 
+	/**
+	 * Queue a path query to run asynchronously, returns the query id passed to ResultDelegate.
+	 * Queries queued during a frame are run as one batch on a task graph worker against an immutable snapshot of the grid.
+	 * ResultDelegate is called on the game thread.
+	 */
+	uint32 FindPathAsync(const FPathFindingQuery& Query, const FNavPathQueryDelegate& ResultDelegate);
+
 	// Project batch of points using shared search extent and filter.
 	virtual void BatchProjectPoints(TArray<FNavigationProjectionWork>& Workload, const FVector& Extent, FSharedConstNavQueryFilter Filter = NULL, const UObject* Querier = NULL) const override;
 
 	bool IsValidRef(FNodeRef NodeRef) const;
 
-	FNodeRef GetNeighbour(const FSearchNode& SearchNodeRef, const int32 NeighbourIndex) const;
-
 	int32 GetNeighbourCount(FNodeRef NodeRef) const;
 
 	FVector NodeRefToLocation(FNodeRef NodeRef) const;
 
+	// Same as above, but with the height given, so it doesn't read the actor location and is safe off the game thread.
+	FVector NodeRefToLocation(FNodeRef NodeRef, float LocationZ) const;
+
 	FNodeRef LocationToNodeRef(FVector Location) const;
 
 	void ResetTiles();
 
+	/**
+	 * Get the flow field towards TargetNodeRef, it is built once per grid change and shared by all queries.
+	 * Only the game thread may call it.
+	 */
+	const FAmGridFlowField& GetFlowField(FNodeRef TargetNodeRef) const;
+
 	void GetReachableTiles(AController* Controller, TArray<float>& OutCosts, bool bAddMovementDelay = false) const;
 
+	/**
+	 * Check in constant time if EndNodeRef can be reached from StartNodeRef at all, bombs can never be passed.
+	 * Unless bAllowBlocks is set, the route must be free of breakable blocks too. Only the game thread may call it.
+	 */
+	bool AreNodesConnected(FNodeRef StartNodeRef, FNodeRef EndNodeRef, bool bAllowBlocks) const;
+
+	// Move the character to NodeRef in the occupancy table, an invalid NodeRef removes the character from it.
+	void SetCharacterTile(const APawn* Character, FNodeRef NodeRef);
+
+	/* NodeRef based tile access. NodeRef must be valid, no location conversion is done. */
+
+	FORCEINLINE const FAmGridData& GetGrid() const
+	{
+		return Grid;
+	}
+
+	FORCEINLINE const FAmGridLandmarks& GetLandmarks() const
+	{
+		return Landmarks;
+	}
+
+	FORCEINLINE int64 GetNodeCost(FNodeRef NodeRef) const
+	{
+		return Grid.GetCost(NodeRef);
+	}
+
+	FORCEINLINE float GetNodeTimeout(FNodeRef NodeRef) const
+	{
+		return Grid.GetTimeout(NodeRef);
+	}
+
+	FORCEINLINE bool IsNodeDangerous(FNodeRef NodeRef, float TimeBeforeTileMin, float TimeAfterTileMax) const
+	{
+		return Grid.IsDangerous(NodeRef, TimeBeforeTileMin, TimeAfterTileMax);
+	}
+
+	// Intervals are in absolute world time.
+	void SetNodeDangerIntervals(FNodeRef NodeRef, TArrayView<const FAmGridDangerInterval> Intervals);
+
+	FORCEINLINE float GetTileExplosionDuration() const
+	{
+		return TileExplosionDuration;
+	}
+
 	UFUNCTION(BlueprintCallable)
 	int64 GetTileCost(FVector Location) const;
 
@@ -95,21 +305,36 @@ public:
 	UFUNCTION(BlueprintCallable)
 	float GetTileTimeout(FVector Location) const;
 
-	UFUNCTION(BlueprintCallable)
-	void SetTileTimeout(FVector Location, float Timeout);
-
 	UFUNCTION(BlueprintCallable)
 	bool IsTileDangerous(FVector Location, float TimeBeforeTileMin, float TimeAfterTileMax) const;
 
 	UFUNCTION(BlueprintCallable)
 	bool IsPathSafe(AController* Controller, const TArray<FVector>& PathPoints) const;
 
+	/**
+	 * Watch the path of the controller instead of polling IsPathSafe, replaces the path watched before.
+	 * OnPathUnsafe is broadcast once a tile on the path changes and the path is not safe anymore, the watch is removed then.
+	 * Returns false if the path could not be watched, the caller has to poll IsPathSafe then.
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool WatchPath(AController* Controller, const TArray<FVector>& PathPoints);
+
+	UFUNCTION(BlueprintCallable)
+	void UnwatchPath(AController* Controller);
+
 	UFUNCTION(BlueprintCallable)
 	FVector FindNearestCharacter(AController* Controller) const;
 
 	UFUNCTION(BlueprintCallable)
 	bool IsCharacterNearby(AController* Controller, int64 RadiusTiles) const;
 
+	UPROPERTY(BlueprintAssignable)
+	FGridPathUnsafe OnPathUnsafe;
+
+	// Center of the tile to move to next from Location on the way to TargetLocation, Location's tile center if there is no move.
+	UFUNCTION(BlueprintCallable)
+	FVector GetFlowFieldNextLocation(FVector Location, FVector TargetLocation) const;
+
 private:
 
 	FORCEINLINE const FNavigationQueryFilter& GetRightFilterRef(FSharedConstNavQueryFilter Filter) const
@@ -117,7 +342,64 @@ private:
 		return *(Filter.IsValid() ? Filter.Get() : GetDefaultQueryFilter().Get());
 	}
 
-	void BFS(AController* Controller, const FNodeDescription& StartNode, std::function<bool(const FNodeDescription& CurrentNode)> NodeRefFunc, ETileNavCost::Type MaxTileNavCostAllowed) const;
+	// Querier is used to keep per-agent state of the incremental search, queries without one use plain A*.
+	// Find a path and fill GridPath with it. Only reads the grid the filter points to, so it can run off the game thread on a snapshot.
+	// Path points are placed at LocationZ, the nav mesh height, which is read on the game thread by the caller.
+	ENavigationQueryResult::Type FillPath(FVector QueryStartLocation, FVector QueryEndLocation, float LocationZ, const FAmGridQueryFilter& QueryFilter, FAmGridPath& GridPath, const UObject* Querier) const;
+
+	EGraphAStarResult FindPathNodes(FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& QueryFilter, FResultPathNodes& OutPathNodes, const UObject* Querier = nullptr) const;
+
+	// Run the queries queued by FindPathAsync as one batch.
+	void DispatchAsyncPathQueries();
+
+	// Get an up to date copy of the grid, null if both snapshot buffers are still in use.
+	TSharedPtr<const FAmGridData, ESPMode::ThreadSafe> GetGridSnapshot();
+
+	/**
+	 * Get traversal costs of every tile reachable by the controlled pawn, unreachable tiles have the max int64 cost.
+	 * The result is shared by all queries of the controller until the pawn leaves its tile or any tile changes.
+	 */
+	const TArray<int64>& GetReachableCosts(AController* Controller, int64 StartCost, ETileNavCost::Type MaxTileNavCostAllowed) const;
+
+	/**
+	 * Get the nearest other character of the controlled pawn from the character field, null if there is none.
+	 * The field is rebuilt at most once per grid or character tiles change, so the lookup is O(1) for every bot.
+	 */
+	const FCharacterFieldEntry* FindNearestCharacterEntry(AController* Controller) const;
+
+	void UpdateCharacterField() const;
+
+	// OutNextCheckTime is lowered to the world time the verdict of a safe path changes unless its tiles or the character's tile change.
+	bool IsPathNodesSafe(AController* Controller, const TArray<FNodeRef>& PathNodeRefs, float* OutNextCheckTime = nullptr) const;
+
+	// Get every tile of the path, points of a segment have to share a row or a column.
+	void GetPathNodeRefs(const TArray<FVector>& PathPoints, TArray<FNodeRef>& OutNodeRefs) const;
+
+	// Check the watched path from the character's current tile and find when it has to be checked again.
+	bool UpdatePathWatchTiming(FPathWatch& PathWatch, AController& Controller) const;
+
+	void SetPathWatchBits(int32 Index, bool bIsSet);
+
+	void RemovePathWatch(int32 Index);
+
+	void MarkPathWatchesDirty(FNodeRef NodeRef);
+
+	// Check the watched paths tiles changed on since the last tick.
+	void UpdatePathWatches();
+
+	// Drop cached paths that go through or next to tiles changed since the last lookup.
+	void UpdatePathCache() const;
+
+	// Speed multipliers of the same class share cached paths.
+	static int32 GetPathCacheSpeedClass(float SpeedMultiplier);
+
+	const FCachedPath* FindCachedPath(FNodeRef StartNodeRef, FNodeRef EndNodeRef, float SpeedMultiplier) const;
+
+	void AddCachedPath(FNodeRef StartNodeRef, FNodeRef EndNodeRef, float SpeedMultiplier, const FResultPathNodes& PathNodes) const;
+
+	// Visitor is called once for every reached node in the order of traversal cost and returns false to stop the search.
+	template<typename TVisitor>
+	void Dijkstra(AController* Controller, const FNodeDescription& StartNode, TVisitor&& Visitor, ETileNavCost::Type MaxTileNavCostAllowed) const;
 
 public:
 
@@ -127,15 +409,83 @@ public:
 	UPROPERTY(EditInstanceOnly, BlueprintReadOnly, Category = "Properties", meta = (ClampMin = "0"))
 	int32 Columns;
 
+	/** Algorithm used by FindPath and TestPath. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties")
+	EAmGridPathfindingMode PathfindingMode;
+
+	/** How long a tile stays dangerous after it explodes, the length of the danger intervals of blast tiles. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties", meta = (ClampMin = "0"))
+	float TileExplosionDuration;
+
+	/** Tiles that explode sooner than this cost as much as bombs in flow fields. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties", meta = (ClampMin = "0"))
+	float FlowFieldDangerTime;
+
+	/** Side of a cluster of the hierarchical search in tiles. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties", meta = (ClampMin = "2"))
+	int32 HierarchyClusterSize;
+
+	/** Number of landmarks of the search heuristic, 0 falls back to the Manhattan distance. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties", meta = (ClampMin = "0", ClampMax = "8"))
+	int32 LandmarkCount;
+
+	/** Number of paths of the nav mesh grid kept for repeated queries, 0 disables the cache. */
+	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties", meta = (ClampMin = "0"))
+	int32 PathCacheSize;
+
 protected:
 
-	/** Array of tile costs that compose the grid. */
-	UPROPERTY(VisibleAnywhere, Category = "Properties")
-	TArray<int64> TileCosts;
+	/** Packed tiles that compose the grid. */
+	FAmGridData Grid;
+
+	/** Incremental search state per querier, path queries are only made from the game thread. */
+	mutable TMap<TWeakObjectPtr<const UObject>, TSharedPtr<FAmGridIncrementalSearch>> IncrementalSearches;
+
+	/** Regions of tiles connected without passing blocks or bombs. */
+	mutable FAmGridConnectivity PlainRegions{ ETileType::DEFAULT };
+
+	/** Regions of tiles connected without passing bombs. */
+	mutable FAmGridConnectivity PassableRegions{ ETileType::BLOCK };
+
+	/** Landmark tables of the search heuristic, only used and updated on the game thread. */
+	mutable FAmGridLandmarks Landmarks;
 
-	/** Array of tile timeouts that compose the grid. */
-	UPROPERTY(VisibleAnywhere, Category = "Properties")
-	TArray<float> TileTimeouts;
+	/** Abstract graph of the hierarchical search, only used and updated on the game thread. */
+	mutable FAmGridHierarchy GridHierarchy;
+
+	/** Flow fields per target tile. */
+	mutable TMap<FNodeRef, TSharedPtr<FAmGridFlowField>> FlowFields;
+
+	/** Path queries queued by FindPathAsync since the last batch. */
+	TArray<FAsyncPathQuery> PendingPathQueries;
+
+	uint32 NextPathQueryId;
+
+	/** Batches in flight. */
+	FGraphEventArray PathBatchTasks;
+
+	/** Double buffered grid copies, a new batch gets one while the previous batch can still read the other. */
+	TSharedPtr<FAmGridData, ESPMode::ThreadSafe> GridSnapshots[2];
+
+	/** Tiles of the characters on the grid, kept up to date by the characters themselves. */
+	TArray<FCharacterTile, TInlineAllocator<FAmUtils::MaxPlayers>> CharacterTiles;
+
+	/** Incremented on every CharacterTiles change. */
+	uint32 CharacterTilesVersion;
+
+	mutable FCharacterField CharacterField;
+
+	/** Reachable costs per controller, one entry per start cost and max tile cost combination. */
+	mutable TMap<TWeakObjectPtr<const AController>, TArray<FReachableCosts, TInlineAllocator<3>>> ReachabilityCache;
+
+	/** Paths of repeated queries, only used and updated on the game thread. */
+	mutable FPathCache PathCache;
+
+	/** Paths watched for safety, a watch is found by its bit in PathWatchMasks. */
+	TArray<FPathWatch, TInlineAllocator<FAmUtils::MaxPlayers>> PathWatches;
+
+	/** Bit per watched path going through the tile. */
+	TArray<uint64> PathWatchMasks;
 
 	/** Toggle debug drawing. */
 	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties")
@@ -145,100 +495,3 @@ protected:
 	UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category = "Properties")
 	bool bShowDebugText;
 };
-
-struct FGridGraphAStar : FGraphAStar<AAmGridNavMesh, FGraphAStarDefaultPolicy>
-{
-	FGridGraphAStar(const AAmGridNavMesh& InGraph) : FGraphAStar(InGraph)
-	{
-	}
-
-	template<typename TQueryFilter, typename TResultPathInfo = TArray<FGraphNodeRef> >
-	EGraphAStarResult FindPath(const FSearchNode& StartNode, const FSearchNode& EndNode, const TQueryFilter& Filter, TResultPathInfo& OutPath)
-	{
-		UE_GRAPH_ASTAR_LOG(Display, TEXT(""));
-		UE_GRAPH_ASTAR_LOG(Display, TEXT("Starting FindPath request..."));
-
-		if (!(Graph.IsValidRef(StartNode.NodeRef) && Graph.IsValidRef(EndNode.NodeRef)))
-		{
-			return SearchFail;
-		}
-
-		if (StartNode.NodeRef == EndNode.NodeRef)
-		{
-			return SearchSuccess;
-		}
-
-		if (FGraphAStarDefaultPolicy::bReuseNodePoolInSubsequentSearches)
-		{
-			NodePool.ReinitNodes();
-		}
-		else
-		{
-			NodePool.Reset();
-		}
-		OpenList.Reset();
-
-		// kick off the search with the first node
-		FSearchNode& StartPoolNode = NodePool.Add(StartNode);
-		StartPoolNode.TraversalCost = 0;
-		StartPoolNode.TotalCost = GetHeuristicCost(Filter, StartNode, EndNode) * Filter.GetHeuristicScale();
-
-		OpenList.Push(StartPoolNode);
-
-		int32 BestNodeIndex = StartPoolNode.SearchNodeIndex;
-		float BestNodeCost = StartPoolNode.TotalCost;
-
-		// Fixed StartPoolNode usage. Store these values now, so they are valid after NodePool resizing in ProcessSingleNode.
-		const int32 StartNodeSearchIndex = StartPoolNode.SearchNodeIndex;
-		const int32 StartNodeRef = StartPoolNode.NodeRef;
-
-		EGraphAStarResult Result = EGraphAStarResult::SearchSuccess;
-		const bool bIsBound = true;
-
-		bool bProcessNodes = true;
-		while (OpenList.Num() > 0 && bProcessNodes)
-		{
-			bProcessNodes = ProcessSingleNode(EndNode, bIsBound, Filter, BestNodeIndex, BestNodeCost);
-		}
-
-		// check if we've reached the goal
-		if (BestNodeCost != 0.f)
-		{
-			Result = EGraphAStarResult::GoalUnreachable;
-		}
-
-		// no point to waste perf creating the path if querier doesn't want it
-		if (Result == EGraphAStarResult::SearchSuccess || Filter.WantsPartialSolution())
-		{
-			// store the path. Note that it will be reversed!
-			int32 SearchNodeIndex = BestNodeIndex;
-			int32 PathLength = ShouldIncludeStartNodeInPath(Filter) && BestNodeIndex != StartNodeSearchIndex ? 1 : 0;
-			do
-			{
-				PathLength++;
-				SearchNodeIndex = NodePool[SearchNodeIndex].ParentNodeIndex;
-			} while (NodePool.IsValidIndex(SearchNodeIndex) && NodePool[SearchNodeIndex].NodeRef != StartNodeRef && ensure(PathLength < FGraphAStarDefaultPolicy::FatalPathLength));
-
-			if (PathLength >= FGraphAStarDefaultPolicy::FatalPathLength)
-			{
-				Result = EGraphAStarResult::InfiniteLoop;
-			}
-
-			OutPath.Reset(PathLength);
-			OutPath.AddZeroed(PathLength);
-
-			// store the path
-			UE_GRAPH_ASTAR_LOG(Display, TEXT("Storing path result (length=%i)..."), PathLength);
-			SearchNodeIndex = BestNodeIndex;
-			int32 ResultNodeIndex = PathLength - 1;
-			do
-			{
-				UE_GRAPH_ASTAR_LOG(Display, TEXT("  NodeRef %i"), NodePool[SearchNodeIndex].NodeRef);
-				SetPathInfo(OutPath, ResultNodeIndex--, NodePool[SearchNodeIndex]);
-				SearchNodeIndex = NodePool[SearchNodeIndex].ParentNodeIndex;
-			} while (ResultNodeIndex >= 0);
-		}
-
-		return Result;
-	}
-};
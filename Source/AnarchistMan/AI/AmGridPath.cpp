@@ -0,0 +1,50 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridPath.h"
+
+#include "AmGridNavMesh.h"
+
+const FNavPathType FAmGridPath::Type(&FNavigationPath::Type);
+
+FAmGridPath::FAmGridPath()
+{
+	PathType = FAmGridPath::Type;
+}
+
+void FAmGridPath::ResetForRepath()
+{
+	Super::ResetForRepath();
+
+	NodeRefs.Reset();
+}
+
+void FAmGridPath::SetNodeRefs(TArrayView<const FNodeRef> InNodeRefs, FVector StartLocation, const AAmGridNavMesh& NavMesh)
+{
+	NodeRefs.Reset(InNodeRefs.Num());
+	NodeRefs.Append(InNodeRefs.GetData(), InNodeRefs.Num());
+
+	PathPoints.Reset();
+
+	if (NodeRefs.IsEmpty())
+	{
+		return;
+	}
+
+	PathPoints.Add(FNavPathPoint(StartLocation));
+
+	if (NodeRefs.Num() == 1)
+	{
+		return;
+	}
+
+	// Neighbour tiles differ by the same NodeRef offset as long as the path goes in the same direction.
+	for (int32 Index = 1; Index + 1 < NodeRefs.Num(); Index++)
+	{
+		if (NodeRefs[Index] - NodeRefs[Index - 1] != NodeRefs[Index + 1] - NodeRefs[Index])
+		{
+			PathPoints.Add(FNavPathPoint(NavMesh.NodeRefToLocation(NodeRefs[Index], StartLocation.Z)));
+		}
+	}
+
+	PathPoints.Add(FNavPathPoint(NavMesh.NodeRefToLocation(NodeRefs.Last(), StartLocation.Z)));
+}
@@ -0,0 +1,41 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationData.h"
+#include "AI/AmGridData.h"
+
+class AAmGridNavMesh;
+
+/**
+ * FAmGridPath is a path over grid tiles.
+ * Every tile of the path is kept as a NodeRef, path points are only kept at the ends and the tiles where the path turns,
+ * so a segment is always a straight run of tile centers.
+ */
+struct FAmGridPath : public FNavigationPath
+{
+	typedef FNavigationPath Super;
+
+	FAmGridPath();
+
+	virtual void ResetForRepath() override;
+
+	FORCEINLINE const TArray<FNodeRef>& GetNodeRefs() const
+	{
+		return NodeRefs;
+	}
+
+	// Set the tiles of the path, the start tile included, and rebuild the path points. The start point is placed at StartLocation,
+	// the other points at its height, so the nav mesh actor isn't read and paths can be built off the game thread.
+	// The tiles are copied, so a path reused for repaths keeps its buffers.
+	void SetNodeRefs(TArrayView<const FNodeRef> InNodeRefs, FVector StartLocation, const AAmGridNavMesh& NavMesh);
+
+public:
+
+	static const FNavPathType Type;
+
+private:
+
+	TArray<FNodeRef> NodeRefs;
+};
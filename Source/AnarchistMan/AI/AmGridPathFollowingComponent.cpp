@@ -0,0 +1,47 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridPathFollowingComponent.h"
+
+#include "GameFramework/NavMovementComponent.h"
+
+UAmGridPathFollowingComponent::UAmGridPathFollowingComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	TileAcceptanceRadius = 5.f;
+}
+
+void UAmGridPathFollowingComponent::FollowPathSegment(float DeltaTime)
+{
+	if (!Path.IsValid() || MovementComp == nullptr)
+	{
+		return;
+	}
+
+	const FVector CurrentLocation = MovementComp->GetActorFeetLocation();
+	const FVector CurrentTarget = GetCurrentTargetLocation();
+
+	FVector ToTarget = CurrentTarget - CurrentLocation;
+	ToTarget.Z = 0.f;
+
+	const float Distance = ToTarget.Size();
+	if (Distance < KINDA_SMALL_NUMBER)
+	{
+		return;
+	}
+
+	// Don't overshoot the tile center, the path may turn there.
+	float Speed = MovementComp->GetMaxSpeed();
+	if (DeltaTime > 0.f)
+	{
+		Speed = FMath::Min(Speed, Distance / DeltaTime);
+	}
+
+	FVector MoveVelocity = ToTarget / Distance * Speed;
+
+	PostProcessMove.ExecuteIfBound(this, MoveVelocity);
+	MovementComp->RequestDirectMove(MoveVelocity, false);
+}
+
+bool UAmGridPathFollowingComponent::HasReachedCurrentTarget(const FVector& CurrentLocation) const
+{
+	return FVector::DistSquared2D(CurrentLocation, GetCurrentTargetLocation()) <= FMath::Square(TileAcceptanceRadius);
+}
@@ -0,0 +1,35 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Navigation/PathFollowingComponent.h"
+
+#include "AmGridPathFollowingComponent.generated.h"
+
+/**
+ * UAmGridPathFollowingComponent follows grid paths from tile center to tile center.
+ * Grid path segments are straight runs of tiles, so the agent heads directly for the next turn point
+ * and slows down just enough to stop on it, instead of the generic steering and reach tests.
+ */
+UCLASS()
+class UAmGridPathFollowingComponent : public UPathFollowingComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UAmGridPathFollowingComponent(const FObjectInitializer& ObjectInitializer);
+
+protected:
+
+	virtual void FollowPathSegment(float DeltaTime) override;
+
+	virtual bool HasReachedCurrentTarget(const FVector& CurrentLocation) const override;
+
+protected:
+
+	/** Distance to a tile center at which the tile counts as reached. */
+	UPROPERTY(EditDefaultsOnly, Category = "Properties", meta = (ClampMin = "0"))
+	float TileAcceptanceRadius;
+};
@@ -4,7 +4,12 @@
 #include "AI/AmGridNavMesh.h"
 
 FAmGridQueryFilter::FAmGridQueryFilter(const AAmGridNavMesh* NavMesh, float SpeedMultiplier, bool bDrawDebugShapes) :
-	GridNavMesh(NavMesh), SpeedMultiplier(SpeedMultiplier), bDrawDebugShapes(bDrawDebugShapes)
+	GridNavMesh(NavMesh), Grid(&NavMesh->GetGrid()), Landmarks(&NavMesh->GetLandmarks()), SpeedMultiplier(SpeedMultiplier), bDrawDebugShapes(bDrawDebugShapes)
+{
+}
+
+FAmGridQueryFilter::FAmGridQueryFilter(const FAmGridData& InGrid, float SpeedMultiplier) :
+	GridNavMesh(nullptr), Grid(&InGrid), Landmarks(nullptr), SpeedMultiplier(SpeedMultiplier), bDrawDebugShapes(false)
 {
 }
 
@@ -78,31 +83,59 @@ FVector FAmGridQueryFilter::GetAdjustedEndLocation(const FVector& EndLocation) c
 
 INavigationQueryFilterInterface* FAmGridQueryFilter::CreateCopy() const
 {
-	return new FAmGridQueryFilter(GridNavMesh, SpeedMultiplier, bDrawDebugShapes);
+	return new FAmGridQueryFilter(*this);
 }
 
-float FAmGridQueryFilter::GetHeuristicCost(const FSearchNode& StartNode, const FSearchNode& EndNode) const
+double FAmGridQueryFilter::GetHeuristicCost(const FNodeRef StartNodeRef, const FNodeRef EndNodeRef) const
 {
-	FNodeRef StartNodeRef = StartNode.NodeRef;
-	FNodeRef EndNodeRef = EndNode.NodeRef;
+	const int32 Columns = Grid->GetColumns();
 
 	FIntVector StartNodeLocation;
-	StartNodeLocation.X = (StartNodeRef % GridNavMesh->Columns);
-	StartNodeLocation.Y = (StartNodeRef / GridNavMesh->Columns);
+	StartNodeLocation.X = (StartNodeRef % Columns);
+	StartNodeLocation.Y = (StartNodeRef / Columns);
 
 	FIntVector EndNodeLocation;
-	EndNodeLocation.X = (EndNodeRef % GridNavMesh->Columns);
-	EndNodeLocation.Y = (EndNodeRef / GridNavMesh->Columns);
+	EndNodeLocation.X = (EndNodeRef % Columns);
+	EndNodeLocation.Y = (EndNodeRef / Columns);
 
 	FIntVector Delta = EndNodeLocation - StartNodeLocation;
 
-	return FMath::Abs(Delta.X) + FMath::Abs(Delta.Y);
+	double HeuristicCost = FMath::Abs(Delta.X) + FMath::Abs(Delta.Y);
+
+	if (Landmarks && Landmarks->IsValid())
+	{
+		HeuristicCost = FMath::Max(HeuristicCost, double(Landmarks->GetHeuristicCost(StartNodeRef, EndNodeRef)));
+	}
+
+	return HeuristicCost;
+}
+
+uint64 FAmGridQueryFilter::GetHeuristicVersion() const
+{
+	return Landmarks ? Landmarks->GetVersion() : 0;
 }
 
-float FAmGridQueryFilter::GetTraversalCost(const FSearchNode& StartNode, const FSearchNode& EndNode) const
+bool FAmGridQueryFilter::IsTraversalAllowed(const FNodeRef NodeA, const FNodeRef NodeB) const
 {
-	FNodeRef EndNodeRef = EndNode.NodeRef;
+	bool bTraversalAllowed = true;
 
+	if (Grid->GetCost(NodeB) >= ETileNavCost::BOMB)
+	{
+		bTraversalAllowed = false;
+
+		if (bDrawDebugShapes)
+		{
+			FVector Location = GridNavMesh->NodeRefToLocation(NodeB);
+			Location.Z = 300.f;
+			DrawDebugSphere(GridNavMesh->GetWorld(), Location, 25.f, 8, FColor::White, false, 0.05f);
+		}
+	}
+
+	return bTraversalAllowed;
+}
+
+void FAmGridQueryFilter::GetNodePassingTimes(const int64 StartTraversalCost, float& OutTimeBeforeEndNodeMin, float& OutTimeAfterEndNodeMax) const
+{
 	// We use approximately estimated values.
 
 	// Derived from max default character speed of 600 units/sec.
@@ -110,70 +143,68 @@ float FAmGridQueryFilter::GetTraversalCost(const FSearchNode& StartNode, const F
 	// Worst case of time to pass 100 units (can be worse, but it rarely happens).
 	float TileDefaultMaxPassingTime = 0.35f / SpeedMultiplier;
 	// Average case of time to pass 100 units (derived from observations).
-	float TileDefaultAveragePassingTime = 0.25f / SpeedMultiplier;
+	float TileDefaultAveragePassingTime = GetTilePassingTime();
 	// Average bomb lifetime + 3 tiles.
-	float TileBlockPassingTime = 3.f + TileDefaultAveragePassingTime * 3;
+	float TileBlockPassingTime = GetBlockPassingTime();
 	// Average bomb lifetime + 5 tiles.
 	float TileBombPassingTime = 3.f + TileDefaultAveragePassingTime * 5;
 
-	float TimeBeforeEndNodeMin = 0;
+	OutTimeBeforeEndNodeMin = 0;
 	// + 2 so character's hit box does not overlap explosion tile.
 	// First one to be in the center of EndNode, second one to be in the center of EndNode + 1 node.
-	float TimeAfterEndNodeMax = TileDefaultMaxPassingTime * 2;
+	OutTimeAfterEndNodeMax = TileDefaultMaxPassingTime * 2;
 
-	int64 TraversalCost = StartNode.TraversalCost;
+	int64 TraversalCost = StartTraversalCost;
 
-	TimeBeforeEndNodeMin += TraversalCost / ETileNavCost::BOMB * TileBombPassingTime;
-	TimeAfterEndNodeMax += TraversalCost / ETileNavCost::BOMB * TileBombPassingTime;
+	OutTimeBeforeEndNodeMin += TraversalCost / ETileNavCost::BOMB * TileBombPassingTime;
+	OutTimeAfterEndNodeMax += TraversalCost / ETileNavCost::BOMB * TileBombPassingTime;
 	TraversalCost %= ETileNavCost::BOMB;
 
-	TimeBeforeEndNodeMin += TraversalCost / ETileNavCost::BLOCK * TileBlockPassingTime;
-	TimeAfterEndNodeMax += TraversalCost / ETileNavCost::BLOCK * TileBlockPassingTime;
+	OutTimeBeforeEndNodeMin += TraversalCost / ETileNavCost::BLOCK * TileBlockPassingTime;
+	OutTimeAfterEndNodeMax += TraversalCost / ETileNavCost::BLOCK * TileBlockPassingTime;
 	TraversalCost %= ETileNavCost::BLOCK;
 
-	TimeBeforeEndNodeMin += TraversalCost / ETileNavCost::DEFAULT * TileDefaultMinPassingTime;
-	TimeAfterEndNodeMax += TraversalCost / ETileNavCost::DEFAULT * TileDefaultAveragePassingTime;
+	OutTimeBeforeEndNodeMin += TraversalCost / ETileNavCost::DEFAULT * TileDefaultMinPassingTime;
+	OutTimeAfterEndNodeMax += TraversalCost / ETileNavCost::DEFAULT * TileDefaultAveragePassingTime;
 	TraversalCost %= ETileNavCost::DEFAULT;
+}
 
-	FVector EndNodeLocation = GridNavMesh->NodeRefToLocation(EndNodeRef);
-
-	int64 PathCost = GridNavMesh->GetTileCost(EndNodeLocation);
-
-	if (GridNavMesh->GetTileTimeout(EndNodeLocation) != AAmGridNavMesh::TIMEOUT_UNSET)
+float FAmGridQueryFilter::GetNodeDangerChangeTime(const int64 StartTraversalCost, const FNodeRef EndNodeRef) const
+{
+	if (!Grid->HasTimeout(EndNodeRef))
 	{
-		// Check if the tile explodes while we run through it.
-		if (GridNavMesh->IsTileDangerous(EndNodeLocation, TimeBeforeEndNodeMin, TimeAfterEndNodeMax))
-		{
-			PathCost = ETileNavCost::BOMB;
-
-			if (bDrawDebugShapes)
-			{
-				EndNodeLocation.Z = 300.f;
-				DrawDebugSphere(GridNavMesh->GetWorld(), EndNodeLocation, 25.f, 8, FColor::Black, false, 0.05f);
-			}
-		}
+		return TNumericLimits<float>::Max();
 	}
 
-	return PathCost;
+	float TimeBeforeEndNodeMin;
+	float TimeAfterEndNodeMax;
+	GetNodePassingTimes(StartTraversalCost, TimeBeforeEndNodeMin, TimeAfterEndNodeMax);
+
+	return Grid->GetDangerChangeTime(EndNodeRef, TimeBeforeEndNodeMin, TimeAfterEndNodeMax);
 }
 
-bool FAmGridQueryFilter::IsTraversalAllowed(const FNodeRef NodeA, const FNodeRef NodeB) const
+int64 FAmGridQueryFilter::GetNodeTraversalCost(const int64 StartTraversalCost, const FNodeRef EndNodeRef) const
 {
-	bool bTraversalAllowed = true;
+	float TimeBeforeEndNodeMin;
+	float TimeAfterEndNodeMax;
+	GetNodePassingTimes(StartTraversalCost, TimeBeforeEndNodeMin, TimeAfterEndNodeMax);
 
-	FVector Location = GridNavMesh->NodeRefToLocation(NodeB);
-	if (GridNavMesh->GetTileCost(Location) >= ETileNavCost::BOMB)
+	int64 PathCost = Grid->GetCost(EndNodeRef);
+
+	// Check if the tile explodes while we run through it.
+	if (Grid->IsDangerous(EndNodeRef, TimeBeforeEndNodeMin, TimeAfterEndNodeMax))
 	{
-		bTraversalAllowed = false;
+		PathCost = ETileNavCost::BOMB;
 
 		if (bDrawDebugShapes)
 		{
-			Location.Z = 300.f;
-			DrawDebugSphere(GridNavMesh->GetWorld(), Location, 25.f, 8, FColor::White, false, 0.05f);
+			FVector EndNodeLocation = GridNavMesh->NodeRefToLocation(EndNodeRef);
+			EndNodeLocation.Z = 300.f;
+			DrawDebugSphere(GridNavMesh->GetWorld(), EndNodeLocation, 25.f, 8, FColor::Black, false, 0.05f);
 		}
 	}
 
-	return bTraversalAllowed;
+	return PathCost;
 }
 
 bool FAmGridQueryFilter::WantsPartialSolution() const
@@ -181,7 +212,38 @@ bool FAmGridQueryFilter::WantsPartialSolution() const
 	return true;
 }
 
-void FAmGridQueryFilter::SetSpeedMultiplier(float Multiplier) const
+float FAmGridQueryFilter::GetTilePassingTime() const
+{
+	return 0.25f / SpeedMultiplier;
+}
+
+float FAmGridQueryFilter::GetBlockPassingTime() const
+{
+	return 3.f + GetTilePassingTime() * 3;
+}
+
+float FAmGridQueryFilter::GetSpeedMultiplier() const
+{
+	return SpeedMultiplier;
+}
+
+void FAmGridQueryFilter::SetSpeedMultiplier(float Multiplier)
 {
 	SpeedMultiplier = Multiplier;
 }
+
+void FAmGridQueryFilter::SetGrid(const FAmGridData* InGrid)
+{
+	Grid = InGrid;
+	Landmarks = GridNavMesh && Grid == &GridNavMesh->GetGrid() ? &GridNavMesh->GetLandmarks() : nullptr;
+}
+
+void FAmGridQueryFilter::SetDrawDebugShapes(bool bInDrawDebugShapes)
+{
+	bDrawDebugShapes = bInDrawDebugShapes;
+}
+
+void FAmGridQueryFilter::DisableLandmarks()
+{
+	Landmarks = nullptr;
+}
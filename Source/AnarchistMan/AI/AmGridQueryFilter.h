@@ -5,9 +5,11 @@
 #include "CoreMinimal.h"
 #include "GraphAStar.h"
 #include "Navigation/NavLocalGridData.h"
+#include "AI/AmGridData.h"
 #include "Game/AmUtils.h"
 
 class AAmGridNavMesh;
+class FAmGridLandmarks;
 
 /**
  * TQueryFilter (FindPath's parameter) filter class is what decides which graph edges can be used and at what cost.
@@ -16,11 +18,13 @@ class AAmGridNavMesh;
 class FAmGridQueryFilter : public INavigationQueryFilterInterface
 {
 	typedef FNavLocalGridData::FNodeRef FNodeRef;
-	typedef FGraphAStarDefaultNode<AAmGridNavMesh> FSearchNode;
 
 public:
 	FAmGridQueryFilter(const AAmGridNavMesh* NavMesh, float SpeedMultiplier, bool bDrawDebug);
 
+	// Filter of a grid that has no nav mesh, e.g. in benchmarks. Landmarks and debug shapes are not available.
+	FAmGridQueryFilter(const FAmGridData& InGrid, float SpeedMultiplier);
+
 	virtual void Reset() override;
 
 	virtual void SetAreaCost(uint8 AreaType, float Cost) override;
@@ -39,27 +43,69 @@ public:
 	virtual FVector GetAdjustedEndLocation(const FVector& EndLocation) const override;
 	virtual INavigationQueryFilterInterface* CreateCopy() const override;
 
-	/* FGraphAStar functions. */
+	/* Grid search functions. */
 
-	// Estimate of cost from StartNode to EndNode from a search node
-	float GetHeuristicCost(const FSearchNode& StartNode, const FSearchNode& EndNode) const;
+	// Estimate of cost from StartNodeRef to EndNodeRef, landmarks are used when available
+	double GetHeuristicCost(const FNodeRef StartNodeRef, const FNodeRef EndNodeRef) const;
 
-	// Real cost of traveling from StartNode directly to EndNode from a search node
-	float GetTraversalCost(const FSearchNode& StartNode, const FSearchNode& EndNode) const;
+	// Changes every time the heuristic of the same tiles may change
+	uint64 GetHeuristicVersion() const;
 
 	// Whether traversing given edge is allowed from a NodeRef
 	bool IsTraversalAllowed(const FNodeRef NodeA, const FNodeRef NodeB) const;
 
+	// Real cost of entering EndNodeRef after StartTraversalCost was spent on the way to it
+	int64 GetNodeTraversalCost(const int64 StartTraversalCost, const FNodeRef EndNodeRef) const;
+
+	// Earliest arrival at and latest departure from a tile entered after StartTraversalCost, relative to the grid time
+	void GetNodePassingTimes(const int64 StartTraversalCost, float& OutTimeBeforeEndNodeMin, float& OutTimeAfterEndNodeMax) const;
+
+	// World time GetNodeTraversalCost of the same tile and start cost may return another danger verdict at
+	float GetNodeDangerChangeTime(const int64 StartTraversalCost, const FNodeRef EndNodeRef) const;
+
 	// Whether to accept solutions that do not reach the goal
 	bool WantsPartialSolution() const;
 
-	void SetSpeedMultiplier(float Multiplier) const;
+	// Average time to pass a plain tile.
+	float GetTilePassingTime() const;
+
+	// Time to get through a breakable block: bomb lifetime plus a few tiles to hide from the explosion.
+	float GetBlockPassingTime() const;
+
+	float GetSpeedMultiplier() const;
+
+	void SetSpeedMultiplier(float Multiplier);
+
+	FORCEINLINE const FAmGridData& GetGrid() const
+	{
+		return *Grid;
+	}
+
+	// Evaluate tiles of another grid, e.g. a snapshot used off the game thread. Landmarks are only used with the nav mesh grid.
+	void SetGrid(const FAmGridData* InGrid);
+
+	void SetDrawDebugShapes(bool bInDrawDebugShapes);
+
+	FORCEINLINE bool UsesLandmarks() const
+	{
+		return Landmarks != nullptr;
+	}
+
+	// Use the plain distance heuristic only, e.g. off the game thread where the landmark tables may be updated concurrently.
+	void DisableLandmarks();
 
 private:
 
+	// Null for a grid without a nav mesh.
 	const AAmGridNavMesh* GridNavMesh;
 
-	mutable float SpeedMultiplier;
+	// Tiles the costs are evaluated on, the nav mesh grid by default.
+	const FAmGridData* Grid;
+
+	// Landmarks of the nav mesh grid, null for other grids.
+	const FAmGridLandmarks* Landmarks;
+
+	float SpeedMultiplier;
 
 	bool bDrawDebugShapes;
 };
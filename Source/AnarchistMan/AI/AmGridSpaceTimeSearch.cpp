@@ -0,0 +1,221 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmGridSpaceTimeSearch.h"
+
+#include "AmGridNavMesh.h"
+#include "AmGridQueryFilter.h"
+
+void FAmGridSpaceTimeSearch::ReserveStates(int32 NumStates)
+{
+	if (StateEpochs.Num() >= NumStates)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_Grid_Navigation_SearchAllocations);
+
+	StateEpochs.Init(0, NumStates);
+	StateNodes.SetNumUninitialized(NumStates);
+	Epoch = 0;
+}
+
+EGraphAStarResult FAmGridSpaceTimeSearch::FindPath(const FAmGridData& InGrid, FNodeRef StartNodeRef, FNodeRef InEndNodeRef, const FAmGridQueryFilter& InFilter, TArray<FAmGridPathNode>& OutPath, bool& bOutIsPartial)
+{
+	bOutIsPartial = false;
+
+	if (!(InGrid.IsValidIndex(StartNodeRef) && InGrid.IsWalkable(StartNodeRef) && InGrid.IsValidIndex(InEndNodeRef) && InGrid.IsWalkable(InEndNodeRef)))
+	{
+		return SearchFail;
+	}
+
+	if (StartNodeRef == InEndNodeRef)
+	{
+		return SearchSuccess;
+	}
+
+	EndNodeRef = InEndNodeRef;
+	TimeStepDuration = InFilter.GetTilePassingTime();
+
+	// Find when the last known explosion is over, every state after that behaves the same.
+	const float LastExplosionEnd = FMath::Max(InGrid.GetLastDangerEnd() - InGrid.GetTime(), 0.f);
+	TimeHorizon = FMath::Min(FMath::FloorToInt(LastExplosionEnd / TimeStepDuration) + 1, MAX_TIME_STEPS);
+
+	const int32 BlockTimeSteps = FMath::CeilToInt(InFilter.GetBlockPassingTime() / TimeStepDuration);
+
+	Grid = &InGrid;
+	Filter = &InFilter;
+
+	NodePool.Reset();
+	OpenList.Reset();
+
+	// Only the states of the time steps up to the horizon are used, the lookup grows to the longest horizon seen.
+	ReserveStates(InGrid.Num() * (TimeHorizon + 1));
+	Epoch++;
+	if (Epoch == 0)
+	{
+		StateEpochs.Init(0, StateEpochs.Num());
+		Epoch = 1;
+	}
+
+	FNodeSorter NodeSorter{ NodePool };
+
+	// Kick off the search with the first node. The agent can always leave the tile it stands on.
+	FSpaceTimeNode& StartNode = NodePool.AddDefaulted_GetRef();
+	StartNode.NodeRef = StartNodeRef;
+	StartNode.TimeStep = 0;
+	StartNode.ParentIndex = INDEX_NONE;
+	StartNode.TraversalCost = 0;
+	StartNode.HeuristicCost = GetHeuristicCost(StartNodeRef);
+	StartNode.TotalCost = StartNode.HeuristicCost;
+	StartNode.bIsClosed = false;
+
+	StateNodes[StartNodeRef] = 0;
+	StateEpochs[StartNodeRef] = Epoch;
+	OpenList.HeapPush(0, NodeSorter);
+	BestNodeIndex = 0;
+
+	EGraphAStarResult Result = GoalUnreachable;
+
+	while (OpenList.Num() > 0)
+	{
+		int32 NodeIndex;
+		OpenList.HeapPop(NodeIndex, NodeSorter, false);
+
+		if (NodePool[NodeIndex].bIsClosed)
+		{
+			continue;
+		}
+
+		NodePool[NodeIndex].bIsClosed = true;
+		INC_DWORD_STAT(STAT_Grid_Navigation_NodesExpanded);
+
+		// Copy, the pool can grow while successors are added.
+		const FSpaceTimeNode Node = NodePool[NodeIndex];
+
+		if (Node.NodeRef == EndNodeRef)
+		{
+			BestNodeIndex = NodeIndex;
+			Result = SearchSuccess;
+			break;
+		}
+
+		// Wait in place, pointless once every explosion is over.
+		if (Node.TimeStep < TimeHorizon && IsSafe(Node.NodeRef, Node.TimeStep + 1))
+		{
+			AddSuccessor(NodeIndex, Node.NodeRef, Node.TimeStep + 1, ETileNavCost::DEFAULT);
+		}
+
+		const int32 NeighbourCount = InGrid.GetNeighbourCount(Node.NodeRef);
+		for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+		{
+			FNodeRef NeighbourRef = InGrid.GetNeighbour(Node.NodeRef, NeighbourIndex);
+
+			if (!InFilter.IsTraversalAllowed(Node.NodeRef, NeighbourRef))
+			{
+				continue;
+			}
+
+			// A block has to be blown up first, which takes a bomb lifetime.
+			const bool bIsBlock = InGrid.GetType(NeighbourRef) == ETileType::BLOCK;
+			const int32 TimeStep = FMath::Min(Node.TimeStep + (bIsBlock ? BlockTimeSteps : 1), TimeHorizon);
+
+			if (IsSafe(NeighbourRef, TimeStep))
+			{
+				AddSuccessor(NodeIndex, NeighbourRef, TimeStep, bIsBlock ? ETileNavCost::BLOCK : ETileNavCost::DEFAULT);
+			}
+		}
+	}
+
+	// No point to waste perf creating the path if querier doesn't want it.
+	if (Result == SearchSuccess || InFilter.WantsPartialSolution())
+	{
+		StorePath(BestNodeIndex, OutPath, bOutIsPartial);
+	}
+
+	Grid = nullptr;
+	Filter = nullptr;
+
+	return Result;
+}
+
+bool FAmGridSpaceTimeSearch::IsSafe(FNodeRef NodeRef, int32 TimeStep) const
+{
+	// + 2 steps so character's hit box does not overlap explosion tile.
+	// First one to be in the center of the tile, second one to be in the center of the next tile.
+	const float PassStart = TimeStep * TimeStepDuration;
+	const float PassEnd = (TimeStep + 2) * TimeStepDuration;
+
+	return !Grid->IsDangerous(NodeRef, PassStart, PassEnd);
+}
+
+void FAmGridSpaceTimeSearch::AddSuccessor(int32 ParentIndex, FNodeRef SuccessorRef, int32 TimeStep, int64 Cost)
+{
+	const int64 TraversalCost = NodePool[ParentIndex].TraversalCost + Cost;
+	const int32 StateIndex = TimeStep * Grid->Num() + SuccessorRef;
+
+	int32 NodeIndex = FindStateNode(StateIndex);
+
+	if (NodeIndex != INDEX_NONE)
+	{
+		const FSpaceTimeNode& ExistingNode = NodePool[NodeIndex];
+		if (ExistingNode.bIsClosed || ExistingNode.TraversalCost <= TraversalCost)
+		{
+			return;
+		}
+	}
+	else
+	{
+		NodeIndex = NodePool.AddDefaulted();
+		StateNodes[StateIndex] = NodeIndex;
+		StateEpochs[StateIndex] = Epoch;
+
+		FSpaceTimeNode& NewNode = NodePool[NodeIndex];
+		NewNode.NodeRef = SuccessorRef;
+		NewNode.TimeStep = TimeStep;
+		NewNode.HeuristicCost = GetHeuristicCost(SuccessorRef);
+		NewNode.bIsClosed = false;
+	}
+
+	FSpaceTimeNode& Node = NodePool[NodeIndex];
+	Node.ParentIndex = ParentIndex;
+	Node.TraversalCost = TraversalCost;
+	Node.TotalCost = double(TraversalCost) + Node.HeuristicCost;
+
+	OpenList.HeapPush(NodeIndex, FNodeSorter{ NodePool });
+
+	if (Node.HeuristicCost < NodePool[BestNodeIndex].HeuristicCost)
+	{
+		BestNodeIndex = NodeIndex;
+	}
+}
+
+double FAmGridSpaceTimeSearch::GetHeuristicCost(FNodeRef NodeRef) const
+{
+	return Filter->GetHeuristicCost(NodeRef, EndNodeRef) * Filter->GetHeuristicScale();
+}
+
+void FAmGridSpaceTimeSearch::StorePath(int32 NodeIndex, TArray<FAmGridPathNode>& OutPath, bool& bOutIsPartial) const
+{
+	TArray<int32, TInlineAllocator<64>> PathNodes;
+	for (int32 Index = NodeIndex; Index != INDEX_NONE; Index = NodePool[Index].ParentIndex)
+	{
+		PathNodes.Add(Index);
+	}
+
+	OutPath.Reset();
+
+	// Path nodes are stored from the goal to the start.
+	for (int32 PathIndex = PathNodes.Num() - 2; PathIndex >= 0; PathIndex--)
+	{
+		const FSpaceTimeNode& PrevNode = NodePool[PathNodes[PathIndex + 1]];
+		const FSpaceTimeNode& Node = NodePool[PathNodes[PathIndex]];
+
+		if (Node.NodeRef == PrevNode.NodeRef)
+		{
+			bOutIsPartial = true;
+			break;
+		}
+
+		OutPath.Add({ Node.NodeRef, Node.TraversalCost });
+	}
+}
@@ -0,0 +1,101 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GraphAStar.h"
+#include "AI/AmGridData.h"
+
+class FAmGridQueryFilter;
+
+/**
+ * FAmGridSpaceTimeSearch is an A* search over (tile, time step) states.
+ * Time is split into steps of one tile passing time, an agent can move to a neighbour or wait in place every step.
+ * A tile can't be occupied while its explosion is burning, so the result is the fastest path that avoids every explosion,
+ * instead of a path that just avoids tiles that are estimated to be dangerous.
+ * Once every known explosion is over, time no longer matters and all later steps are collapsed into the last one.
+ * State lookups are stamped with the search epoch, so an instance kept per thread doesn't clear or allocate them between searches.
+ */
+class FAmGridSpaceTimeSearch
+{
+	struct FSpaceTimeNode
+	{
+		FNodeRef NodeRef;
+		int32 TimeStep;
+		int32 ParentIndex;
+		int64 TraversalCost;
+		double TotalCost;
+		double HeuristicCost;
+		bool bIsClosed;
+	};
+
+	struct FNodeSorter
+	{
+		const TArray<FSpaceTimeNode>& NodePool;
+
+		FORCEINLINE bool operator()(int32 A, int32 B) const
+		{
+			return NodePool[A].TotalCost < NodePool[B].TotalCost;
+		}
+	};
+
+public:
+
+	// Upper bound of time steps the search looks ahead.
+	static constexpr int32 MAX_TIME_STEPS = 64;
+
+	/**
+	 * Find the fastest safe path from StartNodeRef to EndNodeRef.
+	 * OutPath receives every tile of the path except the start one, together with the cost accumulated to reach it.
+	 * A navigation path can't express waiting, so the path is cut at the first tile the agent has to wait on
+	 * and bOutIsPartial is set, the agent is expected to replan from there.
+	 * If the goal is unreachable, the path to the node closest to the goal is stored.
+	 */
+	EGraphAStarResult FindPath(const FAmGridData& InGrid, FNodeRef StartNodeRef, FNodeRef EndNodeRef, const FAmGridQueryFilter& InFilter, TArray<FAmGridPathNode>& OutPath, bool& bOutIsPartial);
+
+private:
+
+	// Size the state lookup for NumStates (time step, tile) states.
+	void ReserveStates(int32 NumStates);
+
+	FORCEINLINE int32 FindStateNode(int32 StateIndex) const
+	{
+		return StateEpochs[StateIndex] == Epoch ? StateNodes[StateIndex] : INDEX_NONE;
+	}
+
+	// Check the tile is not burning while the agent passes it, starting at TimeStep.
+	bool IsSafe(FNodeRef NodeRef, int32 TimeStep) const;
+
+	void AddSuccessor(int32 ParentIndex, FNodeRef SuccessorRef, int32 TimeStep, int64 Cost);
+
+	double GetHeuristicCost(FNodeRef NodeRef) const;
+
+	void StorePath(int32 NodeIndex, TArray<FAmGridPathNode>& OutPath, bool& bOutIsPartial) const;
+
+private:
+
+	// Grid and filter of the current query, only valid during FindPath.
+	const FAmGridData* Grid = nullptr;
+
+	const FAmGridQueryFilter* Filter = nullptr;
+
+	float TimeStepDuration = 0.f;
+
+	// Last time step before every known explosion is over.
+	int32 TimeHorizon = 0;
+
+	FNodeRef EndNodeRef = INDEX_NONE;
+
+	int32 BestNodeIndex = INDEX_NONE;
+
+	TArray<FSpaceTimeNode> NodePool;
+
+	// Pool index per (time step, tile) state, only valid if the epoch of the state is the current one.
+	TArray<int32> StateNodes;
+
+	TArray<uint32> StateEpochs;
+
+	uint32 Epoch = 0;
+
+	TArray<int32> OpenList;
+};
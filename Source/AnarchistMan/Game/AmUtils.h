@@ -72,6 +72,35 @@ struct FAmUtils
 		return Vector;
 	}
 
+	static FORCEINLINE int64 GetTileNavCost(ETileType TileType)
+	{
+		switch (TileType)
+		{
+		case ETileType::BLOCK:
+			return ETileNavCost::BLOCK;
+		case ETileType::BOMB:
+			return ETileNavCost::BOMB;
+		default:
+			return ETileNavCost::DEFAULT;
+		}
+	}
+
+	static FORCEINLINE ETileType GetTileType(int64 TileNavCost)
+	{
+		if (TileNavCost >= ETileNavCost::BOMB)
+		{
+			return ETileType::BOMB;
+		}
+		else if (TileNavCost >= ETileNavCost::BLOCK)
+		{
+			return ETileType::BLOCK;
+		}
+		else
+		{
+			return ETileType::DEFAULT;
+		}
+	}
+
 	static FORCEINLINE uint8 GetPlayerIdFromPawnECC(ECollisionChannel ECC)
 	{
 		switch (ECC)
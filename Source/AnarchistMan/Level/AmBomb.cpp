@@ -4,20 +4,20 @@
 
 #include "Components/BoxComponent.h"
 #include "Components/CapsuleComponent.h"
-#include "Kismet/GameplayStatics.h"
 #include "Net/UnrealNetwork.h"
 
 #include "AI/AmGridNavMesh.h"
 #include "Game/AmUtils.h"
 #include "Level/AmExplosion.h"
+#include "Level/AmExplosionSubsystem.h"
 #include "Player/AmMainPlayerCharacter.h"
 
 AAmBomb::AAmBomb()
 {
 	bReplicates = true;
 
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Bombs are driven by UAmExplosionSubsystem.
+	PrimaryActorTick.bCanEverTick = false;
 
 	// Create an overlap component
 	OverlapComponent = CreateDefaultSubobject<UBoxComponent>(TEXT("OverlapComponent"));
@@ -38,6 +38,16 @@ AAmBomb::AAmBomb()
 	bExplosionTriggered = 0;
 
 	BlockPawnsMask = 0;
+
+	FuseTime = TNumericLimits<float>::Max();
+
+	ExplosionTime = TNumericLimits<float>::Max();
+
+	ExplosionSubsystem = nullptr;
+
+	NavNodeRef = INDEX_NONE;
+
+	ExplosionInfo = {};
 }
 
 void AAmBomb::SetExplosionRadiusTiles(int32 Radius)
@@ -54,30 +64,6 @@ void AAmBomb::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeP
 	DOREPLIFETIME_WITH_PARAMS(AAmBomb, BlockPawnsMask, DoRepLifetimeParams);
 }
 
-void AAmBomb::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-	if (HasAuthority())
-	{
-		auto* GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
-		if (GridNavMesh)
-		{
-			UpdateExplosionConstraints();
-
-			float ExplosionTimeRemaining = GetWorldTimerManager().GetTimerRemaining(TimerHandle_ExplosionTimeoutExpired);
-			if (ExplosionTimeRemaining == -1.f)
-			{
-				float LifeSpanAfterExplosion = TileExplosionDelay * ExplosionMaxRadiusTiles;
-				float LifeSpanRemaining = GetWorldTimerManager().GetTimerRemaining(TimerHandle_LifeSpanExpired);
-				ExplosionTimeRemaining = -(LifeSpanAfterExplosion - LifeSpanRemaining);
-			}
-
-			SetExplosionTilesNavTimeout(GridNavMesh, ExplosionTimeRemaining);
-		}
-	}
-}
-
 // Called when the game starts or when spawned
 void AAmBomb::BeginPlay()
 {
@@ -91,16 +77,16 @@ void AAmBomb::BeginPlay()
 
 	if (HasAuthority())
 	{
+		ExplosionSubsystem = GetWorld()->GetSubsystem<UAmExplosionSubsystem>();
+		check(ExplosionSubsystem);
+
 		if (ExplosionTimeout > 0.0f)
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_ExplosionTimeoutExpired, this, &AAmBomb::ExplosionTimeoutExpired, ExplosionTimeout);
-		}
-		else
-		{
-			GetWorldTimerManager().ClearTimer(TimerHandle_ExplosionTimeoutExpired);
+			FuseTime = GetWorld()->GetTimeSeconds() + ExplosionTimeout;
+			ExplosionTime = FuseTime;
 		}
 
-		SetLifeSpan(ExplosionTimeout + TileExplosionDelay * ExplosionMaxRadiusTiles);
+		ExplosionSubsystem->RegisterBomb(this);
 
 		// Do not block players if they are overlapping a bomb
 		{
@@ -134,14 +120,28 @@ void AAmBomb::BeginPlay()
 
 		OverlapComponent->OnComponentEndOverlap.AddDynamic(this, &AAmBomb::HandleEndOverlap);
 
-		auto* GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
-		FVector Location = GetActorLocation();
-		auto Cost = FMath::Max<int64>(GridNavMesh->GetTileCost(Location), ETileNavCost::BOMB);
-		GridNavMesh->SetTileCost(Location, Cost);
-		GridNavMesh->SetTileTimeout(Location, AAmGridNavMesh::TIMEOUT_UNSET);
+		auto* GridNavMesh = ExplosionSubsystem->GetGridNavMesh();
+		if (GridNavMesh)
+		{
+			FVector Location = GetActorLocation();
+			NavNodeRef = GridNavMesh->LocationToNodeRef(Location);
+
+			auto Cost = FMath::Max<int64>(GridNavMesh->GetTileCost(Location), ETileNavCost::BOMB);
+			GridNavMesh->SetTileCost(Location, Cost);
+		}
 	}
 }
 
+void AAmBomb::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ExplosionSubsystem)
+	{
+		ExplosionSubsystem->UnregisterBomb(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void AAmBomb::HandleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
 	if (bExplosionTriggered)
@@ -187,7 +187,10 @@ void AAmBomb::BlowUp_Implementation()
 		return;
 	}
 
-	auto* GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
+	// A bomb blown up by another blast explodes now, its blast tiles expire from now on too.
+	ExplosionTime = FMath::Min(ExplosionTime, GetWorld()->GetTimeSeconds());
+
+	auto* GridNavMesh = ExplosionSubsystem ? ExplosionSubsystem->GetGridNavMesh() : nullptr;
 	if (GridNavMesh)
 	{
 		FVector Location = GetActorLocation();
@@ -203,16 +206,11 @@ void AAmBomb::BlowUp_Implementation()
 	OnRep_BlockPawns();
 }
 
-void AAmBomb::LifeSpanExpired()
+void AAmBomb::EndExplosion()
 {
-	auto* GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
-	if (HasAuthority() && GridNavMesh)
-	{
-		UpdateExplosionConstraints();
-
-		SetExplosionTilesNavTimeout(GridNavMesh, AAmGridNavMesh::TIMEOUT_UNSET);
-	}
+	check(HasAuthority());
 
+	// The blast tiles leave the detonation schedule once the bomb is unregistered.
 	Destroy();
 }
 
@@ -289,219 +287,73 @@ void AAmBomb::ScheduleTileExplosion(FTransform Transform, float Delay)
 {
 	check(HasAuthority());
 
-	if (Delay != 0.f)
-	{
-		FTimerHandle TimerHandle;
-		GetWorldTimerManager().SetTimer(TimerHandle, [World = GetWorld(), ExplosionClass = ExplosionClass, Transform]()
-		{
-			ExplodeTile(World, ExplosionClass, Transform);
-		}, Delay, false);
-	}
-	else
-	{
-		ExplodeTile(GetWorld(), ExplosionClass, Transform);
-	}
+	ExplosionSubsystem->ScheduleTileExplosion(ExplosionClass, Transform.GetLocation(), Delay);
 }
 
-void AAmBomb::ExplodeTile(UWorld* World, TSubclassOf<AAmExplosion> ExplosionClass, FTransform Transform)
+int32 AAmBomb::TraceBlastRay(const FAmGridData& Grid, EAmGridDirection::Type Direction)
 {
-	if (World == nullptr)
-	{
-		return;
-	}
+	FNodeRef NodeRef = NavNodeRef;
 
-	check(!World->IsNetMode(NM_Client));
-
-	FVector Location = Transform.GetLocation();
-	Location.Z = FAmUtils::RoundToUnitCenter(Location.Z);
-
-	FCollisionObjectQueryParams QueryParams;
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn);
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn1);
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn2);
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn3);
-	QueryParams.AddObjectTypesToQuery(ECC_Pawn4);
-	QueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
-
-	FCollisionShape CollisionShape = FCollisionShape::MakeBox(FVector(FAmUtils::Unit / 8, FAmUtils::Unit / 8, FAmUtils::Unit));
-
-	TArray<FOverlapResult> OutOverlaps{};
-	World->OverlapMultiByObjectType(OutOverlaps, Location, FQuat::Identity, QueryParams, CollisionShape);
-
-	for (const FOverlapResult& Overlap : OutOverlaps)
+	for (int32 Index = 1; Index <= ExplosionMaxRadiusTiles; Index++)
 	{
-		AActor* Actor = Overlap.GetActor();
-		if (IsValid(Actor) && Actor->Implements<UAmExplosiveInterface>())
+		// Static walls stop the blast in front of them.
+		if ((Grid.GetNeighbourMask(NodeRef) & (1 << Direction)) == 0)
 		{
-			IAmExplosiveInterface::Execute_BlowUp(Actor);
+			return Index - 1;
 		}
-	}
-
-	World->SpawnActorAbsolute(ExplosionClass, Transform);
-}
-
-int32 AAmBomb::LineTraceExplosion(FVector Start, FVector End)
-{
-	int32 ExplosionRadiusTiles = std::numeric_limits<int32>::max();
-
-	TArray<FHitResult> OutHits{};
-	GetWorld()->LineTraceMultiByChannel(OutHits, Start, End, ECollisionChannel::ECC_GameExplosion);
-
-	for (const FHitResult& HitResult : OutHits)
-	{
-		if (!HitResult.bBlockingHit)
-		{
-			AActor* Actor = HitResult.GetActor();
 
-			if (!IsValid(Actor) || Actor == this)
-			{
-				continue;
-			}
-
-			if (Actor->Implements<UAmExplosiveInterface>())
-			{
-				if (Actor->IsA<AAmBomb>())
-				{
-					FVector Delta = (Actor->GetActorLocation() - Start) / FAmUtils::Unit;
-					float Timeout = GetWorldTimerManager().GetTimerRemaining(TimerHandle_ExplosionTimeoutExpired);
-					if (Timeout != -1.f)
-					{
-						Cast<AAmBomb>(Actor)->SetChainExplosionLifeSpan(Timeout + TileExplosionDelay * Delta.GetAbsMax());
-					}
-				}
-
-				if (IAmExplosiveInterface::Execute_IsBlockingExplosion(Actor))
-				{
-					float DistanceRounded = FMath::RoundHalfFromZero(HitResult.Distance / FAmUtils::Unit);
-					ExplosionRadiusTiles = static_cast<int32>(DistanceRounded);
+		NodeRef = Grid.GetNeighbourInDirection(NodeRef, Direction);
 
-					break;
-				}
-			}
-		}
-		else
+		// Blocks and bombs are blown up and stop the blast.
+		if (Grid.GetType(NodeRef) != ETileType::DEFAULT)
 		{
-			// Static walls
-			float DistanceRounded = FMath::RoundToZero(HitResult.Distance / FAmUtils::Unit);
-			ExplosionRadiusTiles = static_cast<int32>(DistanceRounded);
+			return Index;
 		}
 	}
 
-	return ExplosionRadiusTiles;
+	return ExplosionMaxRadiusTiles;
 }
 
 void AAmBomb::UpdateExplosionConstraints()
 {
-	FVector Start = GetActorLocation();
-
-	// Left
-	{
-		FVector End = GetActorLocation();
-		End.X = FAmUtils::RoundToUnitCenter(End.X) - FAmUtils::Unit * ExplosionMaxRadiusTiles;
-
-		int32 Constraint = LineTraceExplosion(Start, End);
-		ExplosionInfo.LeftTiles = std::min(ExplosionMaxRadiusTiles, Constraint);
-	}
-
-	// Right
-	{
-		FVector End = GetActorLocation();
-		End.X = FAmUtils::RoundToUnitCenter(End.X) + FAmUtils::Unit * ExplosionMaxRadiusTiles;
-
-		int32 Constraint = LineTraceExplosion(Start, End);
-		ExplosionInfo.RightTiles = std::min(ExplosionMaxRadiusTiles, Constraint);
-	}
-
-	// Up
+	auto* GridNavMesh = ExplosionSubsystem ? ExplosionSubsystem->GetGridNavMesh() : nullptr;
+	if (GridNavMesh == nullptr || !GridNavMesh->IsValidRef(NavNodeRef))
 	{
-		FVector End = GetActorLocation();
-		End.Y = FAmUtils::RoundToUnitCenter(End.Y) - FAmUtils::Unit * ExplosionMaxRadiusTiles;
-
-		int32 Constraint = LineTraceExplosion(Start, End);
-		ExplosionInfo.UpTiles = std::min(ExplosionMaxRadiusTiles, Constraint);
+		ExplosionInfo = {};
+		return;
 	}
 
-	// Down
-	{
-		FVector End = GetActorLocation();
-		End.Y = FAmUtils::RoundToUnitCenter(End.Y) + FAmUtils::Unit * ExplosionMaxRadiusTiles;
+	const FAmGridData& Grid = GridNavMesh->GetGrid();
 
-		int32 Constraint = LineTraceExplosion(Start, End);
-		ExplosionInfo.DownTiles = std::min(ExplosionMaxRadiusTiles, Constraint);
-	}
+	ExplosionInfo.LeftTiles = TraceBlastRay(Grid, EAmGridDirection::LEFT);
+	ExplosionInfo.RightTiles = TraceBlastRay(Grid, EAmGridDirection::RIGHT);
+	ExplosionInfo.UpTiles = TraceBlastRay(Grid, EAmGridDirection::UP);
+	ExplosionInfo.DownTiles = TraceBlastRay(Grid, EAmGridDirection::DOWN);
 }
 
-void AAmBomb::SetExplosionTilesNavTimeout(AAmGridNavMesh* GridNavMesh, float BombExplosionTimeout)
+int32 AAmBomb::GetBlastTiles(EAmGridDirection::Type Direction) const
 {
-	for (int32 Index = 1; Index <= ExplosionMaxRadiusTiles; Index++)
+	switch (Direction)
 	{
-		float Timeout = BombExplosionTimeout + TileExplosionDelay * Index;
-
-		if (Index <= ExplosionInfo.LeftTiles)
-		{
-			FVector Location = GetActorLocation();
-			Location.X = FAmUtils::RoundToUnitCenter(Location.X) - FAmUtils::Unit * Index;
-			SetTileTimeout(GridNavMesh, Location, Timeout);
-		}
-
-		if (Index <= ExplosionInfo.RightTiles)
-		{
-			FVector Location = GetActorLocation();
-			Location.X = FAmUtils::RoundToUnitCenter(Location.X) + FAmUtils::Unit * Index;
-			SetTileTimeout(GridNavMesh, Location, Timeout);
-		}
-
-		if (Index <= ExplosionInfo.UpTiles)
-		{
-			FVector Location = GetActorLocation();
-			Location.Y = FAmUtils::RoundToUnitCenter(Location.Y) - FAmUtils::Unit * Index;
-			SetTileTimeout(GridNavMesh, Location, Timeout);
-		}
-
-		if (Index <= ExplosionInfo.DownTiles)
-		{
-			FVector Location = GetActorLocation();
-			Location.Y = FAmUtils::RoundToUnitCenter(Location.Y) + FAmUtils::Unit * Index;
-			SetTileTimeout(GridNavMesh, Location, Timeout);
-		}
+	case EAmGridDirection::LEFT:
+		return ExplosionInfo.LeftTiles;
+	case EAmGridDirection::RIGHT:
+		return ExplosionInfo.RightTiles;
+	case EAmGridDirection::UP:
+		return ExplosionInfo.UpTiles;
+	case EAmGridDirection::DOWN:
+		return ExplosionInfo.DownTiles;
+	default:
+		return 0;
 	}
 }
 
-void AAmBomb::SetTileTimeout(AAmGridNavMesh* GridNavMesh, FVector Location, float Timeout)
-{
-	if (Timeout > 0.f)
-	{
-		int64 CurrentCost = GridNavMesh->GetTileCost(Location);
-		float CurrentTileTimeout = GridNavMesh->GetTileTimeout(Location);
-		if (CurrentCost <= ETileNavCost::DEFAULT && (CurrentTileTimeout < 0 || CurrentTileTimeout > Timeout))
-		{
-			GridNavMesh->SetTileTimeout(Location, Timeout);
-		}
-	}
-	else
-	{
-		GridNavMesh->SetTileTimeout(Location, AAmGridNavMesh::TIMEOUT_UNSET);
-	}
-}
-
-void AAmBomb::ExplosionTimeoutExpired()
-{
-	Execute_BlowUp(this);
-}
-
-void AAmBomb::SetChainExplosionLifeSpan(float Timeout)
+void AAmBomb::SetExplosionTime(float Time)
 {
 	check(HasAuthority());
 
-	if (bExplosionTriggered)
-	{
-		return;
-	}
-
-	float CurrentExplosionTimeout = GetWorldTimerManager().GetTimerRemaining(TimerHandle_ExplosionTimeoutExpired);
-	if (CurrentExplosionTimeout != -1.f && CurrentExplosionTimeout > Timeout)
+	if (!bExplosionTriggered)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_ExplosionTimeoutExpired, this, &AAmBomb::ExplosionTimeoutExpired, Timeout);
-		GetWorldTimerManager().SetTimer(TimerHandle_LifeSpanExpired, this, &AActor::LifeSpanExpired, Timeout + TileExplosionDelay * ExplosionMaxRadiusTiles);
+		ExplosionTime = Time;
 	}
 }
@@ -5,12 +5,13 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 
+#include "AI/AmGridData.h"
 #include "AmExplosiveInterface.h"
 
 #include "AmBomb.generated.h"
 
 class AAmExplosion;
-class AAmGridNavMesh;
+class UAmExplosionSubsystem;
 class UBoxComponent;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FBombExploded);
@@ -22,10 +23,10 @@ class AAmBomb : public AActor, public IAmExplosiveInterface
 
 	struct FExplosionInfo
 	{
-		int32 LeftTiles;
-		int32 RightTiles;
-		int32 UpTiles;
-		int32 DownTiles;
+		int32 LeftTiles = 0;
+		int32 RightTiles = 0;
+		int32 UpTiles = 0;
+		int32 DownTiles = 0;
 	};
 	
 public:
@@ -37,13 +38,58 @@ public:
 
 	void SetExplosionRadiusTiles(int32 Blocks);
 
-	virtual void Tick(float DeltaTime) override;
+	/* Driven by UAmExplosionSubsystem on the server. */
+
+	FORCEINLINE bool IsExplosionTriggered() const
+	{
+		return bExplosionTriggered;
+	}
+
+	FORCEINLINE FNodeRef GetNodeRef() const
+	{
+		return NavNodeRef;
+	}
+
+	// World time the bomb blows up at by its own timeout.
+	FORCEINLINE float GetFuseTime() const
+	{
+		return FuseTime;
+	}
+
+	// World time the bomb blows up at, a chain reaction may bring it before the fuse time.
+	FORCEINLINE float GetExplosionTime() const
+	{
+		return ExplosionTime;
+	}
+
+	// Set by the chain resolver, has no effect once the bomb has exploded.
+	void SetExplosionTime(float Time);
+
+	FORCEINLINE float GetTileExplosionDelay() const
+	{
+		return TileExplosionDelay;
+	}
+
+	// World time the last tile of the blast explodes at, the bomb is destroyed then.
+	FORCEINLINE float GetExpirationTime() const
+	{
+		return ExplosionTime + TileExplosionDelay * ExplosionMaxRadiusTiles;
+	}
+
+	void UpdateExplosionConstraints();
+
+	// Number of tiles the blast reaches in Direction, as of the last UpdateExplosionConstraints.
+	int32 GetBlastTiles(EAmGridDirection::Type Direction) const;
+
+	void EndExplosion();
 
 protected:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UFUNCTION()
 	void HandleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
@@ -56,25 +102,11 @@ protected:
 
 private:
 
-	virtual void LifeSpanExpired() override;
-
 	void BeginExplosion();
 
 	void ScheduleTileExplosion(FTransform Transform, float Delay);
 
-	static void ExplodeTile(UWorld* World, TSubclassOf<AAmExplosion> ExplosionClass, FTransform Transform);
-
-	int32 LineTraceExplosion(FVector Start, FVector End);
-
-	void UpdateExplosionConstraints();
-
-	void SetExplosionTilesNavTimeout(AAmGridNavMesh* GridNavMesh, float BombExplosionTimeout);
-
-	void SetTileTimeout(AAmGridNavMesh* GridNavMesh, FVector Location, float Timeout);
-
-	void ExplosionTimeoutExpired();
-
-	void SetChainExplosionLifeSpan(float Timeout);
+	int32 TraceBlastRay(const FAmGridData& Grid, EAmGridDirection::Type Direction);
 
 public:
 
@@ -111,5 +143,13 @@ private:
 
 	FExplosionInfo ExplosionInfo;
 
-	FTimerHandle TimerHandle_ExplosionTimeoutExpired;
+	float FuseTime;
+
+	float ExplosionTime;
+
+	// Tile of the bomb on the nav grid.
+	FNodeRef NavNodeRef;
+
+	UPROPERTY(Transient)
+	UAmExplosionSubsystem* ExplosionSubsystem;
 };
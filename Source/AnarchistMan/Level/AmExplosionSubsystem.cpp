@@ -0,0 +1,344 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "AmExplosionSubsystem.h"
+
+#include "Kismet/GameplayStatics.h"
+
+#include "AI/AmGridNavMesh.h"
+#include "Game/AmUtils.h"
+#include "Level/AmBomb.h"
+#include "Level/AmExplosion.h"
+
+void UAmExplosionSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// The tiles of the last bomb still have to be cleared.
+	if (Bombs.IsEmpty() && TileDetonationTimes.IsEmpty() && NumQueuedTileExplosions == 0)
+	{
+		return;
+	}
+
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+
+	ExplodeDueTiles(WorldTime);
+
+	// Blowing up and destroying bombs changes the list, so work on a copy.
+	TArray<AAmBomb*, TInlineAllocator<16>> CurrentBombs(Bombs);
+
+	for (AAmBomb* Bomb : CurrentBombs)
+	{
+		if (IsValid(Bomb) && !Bomb->IsExplosionTriggered() && Bomb->GetExplosionTime() <= WorldTime)
+		{
+			IAmExplosiveInterface::Execute_BlowUp(Bomb);
+		}
+	}
+
+	for (AAmBomb* Bomb : CurrentBombs)
+	{
+		if (IsValid(Bomb) && Bomb->GetExpirationTime() <= WorldTime)
+		{
+			Bomb->EndExplosion();
+		}
+	}
+
+	AAmGridNavMesh* NavMesh = GetGridNavMesh();
+	if (NavMesh == nullptr)
+	{
+		return;
+	}
+
+	if (bBlastsDirty || NavMesh->GetGrid().GetChangeCount() != GridChangeCount)
+	{
+		bBlastsDirty = false;
+
+		ResolveDetonationSchedule(NavMesh);
+
+		// The dangers written by the resolver are not a reason to resolve again.
+		GridChangeCount = NavMesh->GetGrid().GetChangeCount();
+	}
+}
+
+TStatId UAmExplosionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAmExplosionSubsystem, STATGROUP_Tickables);
+}
+
+void UAmExplosionSubsystem::RegisterBomb(AAmBomb* Bomb)
+{
+	Bombs.AddUnique(Bomb);
+	bBlastsDirty = true;
+}
+
+void UAmExplosionSubsystem::UnregisterBomb(AAmBomb* Bomb)
+{
+	Bombs.Remove(Bomb);
+	bBlastsDirty = true;
+}
+
+void UAmExplosionSubsystem::ScheduleTileExplosion(TSubclassOf<AAmExplosion> ExplosionClass, FVector Location, float Delay)
+{
+	if (Delay <= 0.f)
+	{
+		ExplodeTile(ExplosionClass, Location);
+		return;
+	}
+
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+
+	// An empty wheel can be moved on to the current tick right away.
+	if (NumQueuedTileExplosions == 0)
+	{
+		WheelTick = FMath::FloorToInt(WorldTime / WHEEL_TICK_DURATION);
+	}
+
+	int32 ExplosionClassIndex = ExplosionClasses.AddUnique(ExplosionClass);
+	check(ExplosionClassIndex <= TNumericLimits<uint8>::Max());
+
+	// Ticks that have been processed already are not visited again.
+	const uint32 DueTick = FMath::Max<uint32>(FMath::CeilToInt((WorldTime + Delay) / WHEEL_TICK_DURATION), WheelTick + 1);
+
+	TimingWheel[DueTick % WHEEL_SLOTS].Add({ FVector3f(Location), DueTick, uint8(ExplosionClassIndex) });
+	NumQueuedTileExplosions++;
+}
+
+void UAmExplosionSubsystem::MarkBlastsDirty()
+{
+	bBlastsDirty = true;
+}
+
+float UAmExplosionSubsystem::GetTileDetonationTime(FNodeRef NodeRef) const
+{
+	const float* Time = TileDetonationTimes.Find(NodeRef);
+	return Time ? *Time : TNumericLimits<float>::Max();
+}
+
+AAmGridNavMesh* UAmExplosionSubsystem::GetGridNavMesh()
+{
+	if (!GridNavMesh.IsValid())
+	{
+		GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
+	}
+
+	return GridNavMesh.Get();
+}
+
+void UAmExplosionSubsystem::ExplodeDueTiles(float WorldTime)
+{
+	if (NumQueuedTileExplosions == 0)
+	{
+		return;
+	}
+
+	const uint32 CurrentTick = FMath::FloorToInt(WorldTime / WHEEL_TICK_DURATION);
+
+	// Visit every slot at most once, explosions due in later turns of the wheel stay in their slots.
+	const uint32 LastTick = FMath::Min(CurrentTick, WheelTick + WHEEL_SLOTS);
+	for (uint32 Tick = WheelTick + 1; Tick <= LastTick; Tick++)
+	{
+		TArray<FTileExplosion>& Slot = TimingWheel[Tick % WHEEL_SLOTS];
+		for (int32 Index = Slot.Num() - 1; Index >= 0; Index--)
+		{
+			if (Slot[Index].DueTick <= CurrentTick)
+			{
+				DueTileExplosions.Add(Slot[Index]);
+				Slot.RemoveAtSwap(Index, 1, false);
+			}
+		}
+	}
+
+	WheelTick = FMath::Max(WheelTick, CurrentTick);
+	NumQueuedTileExplosions -= DueTileExplosions.Num();
+
+	// Blasts set off here queue their tiles on the wheel, they are never due in the tick already processed.
+	for (const FTileExplosion& TileExplosion : DueTileExplosions)
+	{
+		ExplodeTile(ExplosionClasses[TileExplosion.ExplosionClassIndex], FVector(TileExplosion.Location));
+	}
+
+	DueTileExplosions.Reset();
+
+	if (NumQueuedTileExplosions == 0)
+	{
+		ExplosionClasses.Reset();
+	}
+}
+
+void UAmExplosionSubsystem::ExplodeTile(TSubclassOf<AAmExplosion> ExplosionClass, FVector Location)
+{
+	UWorld* World = GetWorld();
+
+	check(!World->IsNetMode(NM_Client));
+
+	FVector OverlapLocation = Location;
+	OverlapLocation.Z = FAmUtils::RoundToUnitCenter(OverlapLocation.Z);
+
+	FCollisionObjectQueryParams QueryParams;
+	QueryParams.AddObjectTypesToQuery(ECC_Pawn);
+	QueryParams.AddObjectTypesToQuery(ECC_Pawn1);
+	QueryParams.AddObjectTypesToQuery(ECC_Pawn2);
+	QueryParams.AddObjectTypesToQuery(ECC_Pawn3);
+	QueryParams.AddObjectTypesToQuery(ECC_Pawn4);
+	QueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+
+	FCollisionShape CollisionShape = FCollisionShape::MakeBox(FVector(FAmUtils::Unit / 8, FAmUtils::Unit / 8, FAmUtils::Unit));
+
+	TArray<FOverlapResult> OutOverlaps{};
+	World->OverlapMultiByObjectType(OutOverlaps, OverlapLocation, FQuat::Identity, QueryParams, CollisionShape);
+
+	for (const FOverlapResult& Overlap : OutOverlaps)
+	{
+		AActor* Actor = Overlap.GetActor();
+		if (IsValid(Actor) && Actor->Implements<UAmExplosiveInterface>())
+		{
+			IAmExplosiveInterface::Execute_BlowUp(Actor);
+		}
+	}
+
+	FTransform Transform;
+	Transform.SetLocation(Location);
+	Transform.SetRotation(FQuat::Identity);
+
+	World->SpawnActorAbsolute(ExplosionClass, Transform);
+}
+
+void UAmExplosionSubsystem::ResolveDetonationSchedule(AAmGridNavMesh* NavMesh)
+{
+	struct FBombDetonation
+	{
+		float Time;
+		int32 BombIndex;
+
+		bool operator<(const FBombDetonation& Other) const
+		{
+			return Time < Other.Time;
+		}
+	};
+
+	const FAmGridData& Grid = NavMesh->GetGrid();
+
+	TMap<FNodeRef, int32, TInlineSetAllocator<16>> BombIndices;
+	TArray<float, TInlineAllocator<16>> DetonationTimes;
+	TArray<bool, TInlineAllocator<16>> ResolvedBombs;
+	TArray<FBombDetonation, TInlineAllocator<16>> Queue;
+
+	for (int32 BombIndex = 0; BombIndex < Bombs.Num(); BombIndex++)
+	{
+		AAmBomb* Bomb = Bombs[BombIndex];
+
+		// The blast of an exploded bomb is already under way, its extents are kept.
+		const float Time = Bomb->IsExplosionTriggered() ? Bomb->GetExplosionTime() : Bomb->GetFuseTime();
+		if (!Bomb->IsExplosionTriggered())
+		{
+			Bomb->UpdateExplosionConstraints();
+		}
+
+		BombIndices.Add(Bomb->GetNodeRef(), BombIndex);
+		DetonationTimes.Add(Time);
+		ResolvedBombs.Add(false);
+		Queue.HeapPush({ Time, BombIndex });
+	}
+
+	TArray<FTileDetonation> TileDetonations;
+
+	while (Queue.Num() > 0)
+	{
+		FBombDetonation Detonation;
+		Queue.HeapPop(Detonation, false);
+
+		if (ResolvedBombs[Detonation.BombIndex])
+		{
+			continue;
+		}
+		ResolvedBombs[Detonation.BombIndex] = true;
+
+		const AAmBomb* Bomb = Bombs[Detonation.BombIndex];
+		if (!Grid.IsValidIndex(Bomb->GetNodeRef()))
+		{
+			continue;
+		}
+
+		TileDetonations.Add({ Bomb->GetNodeRef(), Detonation.Time });
+
+		for (uint8 Direction = 0; Direction < EAmGridDirection::MAX; Direction++)
+		{
+			const int32 BlastTiles = Bomb->GetBlastTiles(EAmGridDirection::Type(Direction));
+
+			FNodeRef NodeRef = Bomb->GetNodeRef();
+			float TileTime = Detonation.Time;
+			for (int32 Index = 1; Index <= BlastTiles; Index++)
+			{
+				NodeRef = Grid.GetNeighbourInDirection(NodeRef, EAmGridDirection::Type(Direction));
+				TileTime = Detonation.Time + Bomb->GetTileExplosionDelay() * Index;
+				TileDetonations.Add({ NodeRef, TileTime });
+			}
+
+			// A blast stops on the bomb it reaches, which explodes then unless something sets it off sooner.
+			const int32* ChainedBombIndex = BlastTiles > 0 ? BombIndices.Find(NodeRef) : nullptr;
+			if (ChainedBombIndex && !Bombs[*ChainedBombIndex]->IsExplosionTriggered() && TileTime < DetonationTimes[*ChainedBombIndex])
+			{
+				DetonationTimes[*ChainedBombIndex] = TileTime;
+				Queue.HeapPush({ TileTime, *ChainedBombIndex });
+			}
+		}
+	}
+
+	for (int32 BombIndex = 0; BombIndex < Bombs.Num(); BombIndex++)
+	{
+		Bombs[BombIndex]->SetExplosionTime(DetonationTimes[BombIndex]);
+	}
+
+	PublishDetonationSchedule(NavMesh, TileDetonations);
+}
+
+void UAmExplosionSubsystem::PublishDetonationSchedule(AAmGridNavMesh* NavMesh, TArray<FTileDetonation>& TileDetonations)
+{
+	const FAmGridData& Grid = NavMesh->GetGrid();
+
+	// Group the detonations of a tile, earliest first.
+	TileDetonations.Sort([](const FTileDetonation& A, const FTileDetonation& B)
+	{
+		return A.NodeRef != B.NodeRef ? A.NodeRef < B.NodeRef : A.Time < B.Time;
+	});
+
+	TMap<FNodeRef, float> NewTileDetonationTimes;
+	FAmGridDangerIntervals Intervals;
+
+	for (int32 Index = 0; Index < TileDetonations.Num(); )
+	{
+		const FNodeRef NodeRef = TileDetonations[Index].NodeRef;
+		NewTileDetonationTimes.Add(NodeRef, TileDetonations[Index].Time);
+
+		Intervals.Reset();
+		for ( ; Index < TileDetonations.Num() && TileDetonations[Index].NodeRef == NodeRef; Index++)
+		{
+			const float Time = TileDetonations[Index].Time;
+			Intervals.Add({ Time, Time + NavMesh->GetTileExplosionDuration() });
+		}
+
+		// Blocks and bombs are not walked through, so only free tiles carry dangers.
+		if (Grid.GetCost(NodeRef) > ETileNavCost::DEFAULT)
+		{
+			Intervals.Reset();
+		}
+
+		// The grid only logs tiles whose intervals differ, so an unchanged chain costs nothing downstream.
+		NavMesh->SetNodeDangerIntervals(NodeRef, Intervals);
+	}
+
+	// Tiles no blast reaches anymore are safe again.
+	for (const TPair<FNodeRef, float>& TileDetonation : TileDetonationTimes)
+	{
+		if (!NewTileDetonationTimes.Contains(TileDetonation.Key))
+		{
+			NavMesh->SetNodeDangerIntervals(TileDetonation.Key, TArrayView<const FAmGridDangerInterval>());
+		}
+	}
+
+	TileDetonationTimes = MoveTemp(NewTileDetonationTimes);
+}
+
+bool UAmExplosionSubsystem::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,129 @@
+// Copyright 2022 Kiryl Antonik
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AI/AmGridData.h"
+
+#include "AmExplosionSubsystem.generated.h"
+
+class AAmBomb;
+class AAmExplosion;
+class AAmGridNavMesh;
+
+/**
+ * UAmExplosionSubsystem owns the active bombs of the server and drives them from a single tick.
+ * Bombs blow up and expire when their times come. Whenever the grid or the set of bombs changes,
+ * chain reactions are resolved in one pass and the detonation times of every bomb and blast tile are published together,
+ * the nav grid gets them as absolute danger intervals, so nothing is written between the changes.
+ * Tile explosions are queued on a hashed timing wheel and the ones due in the same wheel tick are exploded in one pass.
+ */
+UCLASS()
+class UAmExplosionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	// A blast reaching a tile.
+	struct FTileDetonation
+	{
+		FNodeRef NodeRef;
+		float Time;
+	};
+
+	// Tile explosion queued on the timing wheel.
+	struct FTileExplosion
+	{
+		FVector3f Location;
+
+		// Wheel tick the tile explodes at, the slot is only visited once per turn of the wheel.
+		uint32 DueTick;
+
+		// Index to ExplosionClasses.
+		uint8 ExplosionClassIndex;
+	};
+
+public:
+
+	// Number of slots of the timing wheel.
+	static constexpr int32 WHEEL_SLOTS = 64;
+
+	// Duration of a wheel tick, a turn of the wheel covers a little more than a second.
+	static constexpr float WHEEL_TICK_DURATION = 1.f / 60.f;
+
+public:
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	void RegisterBomb(AAmBomb* Bomb);
+
+	void UnregisterBomb(AAmBomb* Bomb);
+
+	// Explode the tile at Location after Delay, right away if there is no delay.
+	void ScheduleTileExplosion(TSubclassOf<AAmExplosion> ExplosionClass, FVector Location, float Delay);
+
+	// Resolve the detonation schedule again on the next tick.
+	void MarkBlastsDirty();
+
+	// Earliest world time a blast reaches NodeRef, the max float if no blast does.
+	float GetTileDetonationTime(FNodeRef NodeRef) const;
+
+	FORCEINLINE const TMap<FNodeRef, float>& GetDetonationSchedule() const
+	{
+		return TileDetonationTimes;
+	}
+
+	AAmGridNavMesh* GetGridNavMesh();
+
+protected:
+
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+
+private:
+
+	/**
+	 * Trace the blasts of the bombs and find the earliest detonation time of every bomb and tile.
+	 * Bombs are nodes of a graph, a blast ending on a bomb is an edge weighted by the tile explosion delay,
+	 * so the times are the shortest paths from the fuse times, found by Dijkstra's algorithm.
+	 */
+	void ResolveDetonationSchedule(AAmGridNavMesh* NavMesh);
+
+	// Take the tile explosions due by WorldTime off the wheel and explode them.
+	void ExplodeDueTiles(float WorldTime);
+
+	void ExplodeTile(TSubclassOf<AAmExplosion> ExplosionClass, FVector Location);
+
+	// Set the detonation times and write them to the nav grid as danger intervals, only tiles that differ are written.
+	void PublishDetonationSchedule(AAmGridNavMesh* NavMesh, TArray<FTileDetonation>& TileDetonations);
+
+private:
+
+	UPROPERTY()
+	TArray<AAmBomb*> Bombs;
+
+	TWeakObjectPtr<AAmGridNavMesh> GridNavMesh;
+
+	// Earliest detonation time of each blast tile.
+	TMap<FNodeRef, float> TileDetonationTimes;
+
+	TArray<FTileExplosion> TimingWheel[WHEEL_SLOTS];
+
+	// Last wheel tick processed.
+	uint32 WheelTick = 0;
+
+	int32 NumQueuedTileExplosions = 0;
+
+	// Explosion classes of the queued tiles, so a record doesn't have to hold an object reference.
+	UPROPERTY()
+	TArray<TSubclassOf<AAmExplosion>> ExplosionClasses;
+
+	// Kept between ticks, so exploding a batch doesn't allocate.
+	TArray<FTileExplosion> DueTileExplosions;
+
+	// Grid change count the schedule was resolved at.
+	uint64 GridChangeCount = 0;
+
+	bool bBlastsDirty = false;
+};
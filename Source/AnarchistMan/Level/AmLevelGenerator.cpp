@@ -78,7 +78,7 @@ void AAmLevelGenerator::RegenerateLevel()
 	{
 		for (uint64 Column = 1; Column < Columns; Column++)
 		{
-			if (Row % 2 == 0 && Column % 2 == 0)
+			if (!IsBreakableBlockLocation(Row, Column, Rows, Columns))
 			{
 				continue;
 			}
@@ -88,14 +88,6 @@ void AAmLevelGenerator::RegenerateLevel()
 				continue;
 			}
 
-			if (Row < 3 || Row + 3 > Rows)
-			{
-				if (Column < 3 || Column + 3 > Columns)
-				{
-					continue;
-				}
-			}
-
 			FVector Location = FVector(RootLocation.X + Row * FAmUtils::Unit + FAmUtils::Unit / 2, RootLocation.Y + Column * FAmUtils::Unit + FAmUtils::Unit / 2, RootLocation.Z);
 			FTransform Transform;
 			Transform.SetLocation(Location);
@@ -106,6 +98,24 @@ void AAmLevelGenerator::RegenerateLevel()
 	}
 }
 
+bool AAmLevelGenerator::IsBreakableBlockLocation(uint64 Row, uint64 Column, uint64 Rows, uint64 Columns)
+{
+	if (Row % 2 == 0 && Column % 2 == 0)
+	{
+		return false;
+	}
+
+	if (Row < 3 || Row + 3 > Rows)
+	{
+		if (Column < 3 || Column + 3 > Columns)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void AAmLevelGenerator::SpawnPowerUpsBatch()
 {
 	FVector RootLocation = GetActorLocation();
@@ -26,6 +26,9 @@ public:
 
 	void SpawnPowerUpsBatch();
 
+	// Whether a breakable block may be placed on the tile, pillars and the corners players start in stay free.
+	static bool IsBreakableBlockLocation(uint64 Row, uint64 Column, uint64 Rows, uint64 Columns);
+
 protected:
 
 	// Called when the game starts or when spawned
@@ -4,7 +4,9 @@
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
 #include "Net/UnrealNetwork.h"
+#include "AI/AmGridNavMesh.h"
 #include "GameModes/AmMainGameState.h"
 #include "Level/AmBomb.h"
 #include "Player/AmMainPlayerState.h"
@@ -27,6 +29,8 @@ AAmMainPlayerCharacter::AAmMainPlayerCharacter()
 
 	ExplosionRadiusTiles = 1;
 	ActiveBombsLimit = 1;
+
+	NavNodeRef = INDEX_NONE;
 }
 
 // Called to bind functionality to input
@@ -67,6 +71,21 @@ void AAmMainPlayerCharacter::BeginPlay()
 
 	DefaultMaxWalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
 	MaxWalkSpeed = DefaultMaxWalkSpeed;
+
+	if (HasAuthority())
+	{
+		GridNavMesh = Cast<AAmGridNavMesh>(UGameplayStatics::GetActorOfClass(this, AAmGridNavMesh::StaticClass()));
+	}
+}
+
+void AAmMainPlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (GridNavMesh.IsValid())
+	{
+		GridNavMesh->SetCharacterTile(this, INDEX_NONE);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AAmMainPlayerCharacter::Tick(float DeltaTime)
@@ -85,6 +104,8 @@ void AAmMainPlayerCharacter::Tick(float DeltaTime)
 	{
 		GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Walking);
 	}
+
+	UpdateNavTile();
 }
 
 void AAmMainPlayerCharacter::OnRep_PlayerState()
@@ -276,3 +297,18 @@ void AAmMainPlayerCharacter::PlaceBomb_Implementation()
 	Bomb->SetExplosionRadiusTiles(ExplosionRadiusTiles);
 	Bomb->OnBombExploded.AddDynamic(this, &AAmMainPlayerCharacter::OnBombExploded);
 }
+
+void AAmMainPlayerCharacter::UpdateNavTile()
+{
+	if (!GridNavMesh.IsValid())
+	{
+		return;
+	}
+
+	int32 NodeRef = GridNavMesh->LocationToNodeRef(GetActorLocation());
+	if (NodeRef != NavNodeRef)
+	{
+		GridNavMesh->SetCharacterTile(this, NodeRef);
+		NavNodeRef = NodeRef;
+	}
+}
@@ -12,6 +12,7 @@
 class UCameraComponent;
 class AAmBomb;
 class AAmMainPlayerState;
+class AAmGridNavMesh;
 
 /**
  * @brief Delegate executed when a player dies from a bomb explosion.
@@ -60,6 +61,8 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void Tick(float DeltaTime) override;
 
 	virtual void OnRep_PlayerState() override;
@@ -83,6 +86,9 @@ private:
 
 	void SetPlayerColor(AAmMainPlayerState* AMPlayerState);
 
+	// Let the nav mesh know the character has moved to another tile.
+	void UpdateNavTile();
+
 	UFUNCTION()
 	void OnRep_MaxWalkSpeed();
 
@@ -117,4 +123,11 @@ protected:
 
 	UPROPERTY(Transient, BlueprintReadOnly)
 	float DefaultMaxWalkSpeed;
+
+private:
+	UPROPERTY(Transient)
+	TWeakObjectPtr<AAmGridNavMesh> GridNavMesh;
+
+	// Tile the nav mesh has the character registered on.
+	int32 NavNodeRef;
 };
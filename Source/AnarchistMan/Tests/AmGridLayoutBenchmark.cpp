@@ -0,0 +1,176 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "AI/AmGridData.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AmGridLayoutBenchmark
+{
+	// Tile reads every benchmark pass makes, grids are swept as many times as it takes.
+	constexpr int64 TILE_READS = 20000000;
+
+	// Layout the grid used before FAmGridData, parallel arrays of costs and timeouts.
+	struct FSplitGrid
+	{
+		TArray<int64> TileCosts;
+
+		TArray<float> TileTimeouts;
+
+		int32 Rows = 0;
+
+		int32 Columns = 0;
+
+		// Neighbours were found from the tile coordinates, walls were told apart by their location.
+		template <typename VisitorFunc>
+		FORCEINLINE void ForEachNeighbour(FNodeRef NodeRef, VisitorFunc Visitor) const
+		{
+			static const FIntPoint Offsets[] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+			for (const FIntPoint& Offset : Offsets)
+			{
+				const int32 X = NodeRef % Columns + Offset.X;
+				const int32 Y = NodeRef / Columns + Offset.Y;
+				if (X < 0 || X >= Columns || Y < 0 || Y >= Rows || X == 0 || Y == 0 || (X % 2 == 0 && Y % 2 == 0))
+				{
+					continue;
+				}
+
+				Visitor(Y * Columns + X);
+			}
+		}
+	};
+
+	struct FPackedGrid
+	{
+		const FAmGridData& Grid;
+
+		template <typename VisitorFunc>
+		FORCEINLINE void ForEachNeighbour(FNodeRef NodeRef, VisitorFunc Visitor) const
+		{
+			const int32 NeighbourCount = Grid.GetNeighbourCount(NodeRef);
+			for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+			{
+				Visitor(Grid.GetNeighbour(NodeRef, NeighbourIndex));
+			}
+		}
+	};
+
+	void InitGrids(int32 Rows, int32 Columns, FAmGridData& OutGrid, FSplitGrid& OutSplitGrid)
+	{
+		OutGrid.Init(Rows, Columns);
+		OutSplitGrid.TileCosts.Init(ETileNavCost::DEFAULT, OutGrid.Num());
+		OutSplitGrid.TileTimeouts.Init(FAmGridData::TIMEOUT_UNSET, OutGrid.Num());
+		OutSplitGrid.Rows = Rows;
+		OutSplitGrid.Columns = Columns;
+
+		// Roughly the mix of a running match, blocks on a third of the tiles and a few bombs.
+		FRandomStream Random(Rows * Columns);
+		for (FNodeRef NodeRef = 0; NodeRef < OutGrid.Num(); NodeRef++)
+		{
+			if (!OutGrid.IsWalkable(NodeRef))
+			{
+				continue;
+			}
+
+			const float Roll = Random.GetFraction();
+			if (Roll < 0.3f)
+			{
+				OutGrid.SetCost(NodeRef, ETileNavCost::BLOCK);
+				OutSplitGrid.TileCosts[NodeRef] = ETileNavCost::BLOCK;
+			}
+			else if (Roll < 0.35f)
+			{
+				const float Start = Random.FRandRange(0.f, 3.f);
+				const FAmGridDangerInterval Interval = { Start, Start + 0.5f };
+				OutGrid.SetDangerIntervals(NodeRef, MakeArrayView(&Interval, 1));
+				OutSplitGrid.TileTimeouts[NodeRef] = Start;
+			}
+		}
+	}
+
+	// Read cost and timeout of every neighbour, which is what a search does for each expanded tile.
+	// Each layout finds the neighbours on its own, so a sweep only reads the memory of its layout.
+	template <typename LayoutType, typename ReadTileFunc>
+	double SweepNeighbours(const LayoutType& Layout, const TArray<FNodeRef>& Order, ReadTileFunc ReadTile, int64& OutChecksum)
+	{
+		const int64 Passes = FMath::Max<int64>(1, TILE_READS / (Order.Num() * 4));
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int64 Pass = 0; Pass < Passes; Pass++)
+		{
+			for (FNodeRef NodeRef : Order)
+			{
+				Layout.ForEachNeighbour(NodeRef, [&OutChecksum, &ReadTile](FNodeRef NeighbourRef)
+				{
+					OutChecksum += ReadTile(NeighbourRef);
+				});
+			}
+		}
+		return (FPlatformTime::Seconds() - StartTime) / Passes;
+	}
+
+	void RunLayoutBenchmark(FAutomationTestBase& Test, int32 Rows, int32 Columns)
+	{
+		FAmGridData Grid;
+		FSplitGrid SplitGrid;
+		InitGrids(Rows, Columns, Grid, SplitGrid);
+
+		TArray<FNodeRef> LinearOrder;
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			if (Grid.IsWalkable(NodeRef))
+			{
+				LinearOrder.Add(NodeRef);
+			}
+		}
+
+		// Search frontiers jump around the grid, a shuffled order stands for that.
+		TArray<FNodeRef> RandomOrder = LinearOrder;
+		FRandomStream Random(Grid.Num());
+		for (int32 Index = RandomOrder.Num() - 1; Index > 0; Index--)
+		{
+			RandomOrder.Swap(Index, Random.RandRange(0, Index));
+		}
+
+		auto ReadSplitTile = [&SplitGrid](FNodeRef NodeRef)
+		{
+			return SplitGrid.TileCosts[NodeRef] + (SplitGrid.TileTimeouts[NodeRef] > 0.f ? 1 : 0);
+		};
+
+		auto ReadPackedTile = [&Grid](FNodeRef NodeRef)
+		{
+			return Grid.GetCost(NodeRef) + (Grid.GetTimeout(NodeRef) > 0.f ? 1 : 0);
+		};
+
+		const FPackedGrid PackedGrid{ Grid };
+
+		int64 SplitChecksum = 0;
+		int64 PackedChecksum = 0;
+
+		const double SplitLinearTime = SweepNeighbours(SplitGrid, LinearOrder, ReadSplitTile, SplitChecksum);
+		const double PackedLinearTime = SweepNeighbours(PackedGrid, LinearOrder, ReadPackedTile, PackedChecksum);
+		const double SplitRandomTime = SweepNeighbours(SplitGrid, RandomOrder, ReadSplitTile, SplitChecksum);
+		const double PackedRandomTime = SweepNeighbours(PackedGrid, RandomOrder, ReadPackedTile, PackedChecksum);
+
+		Test.TestEqual(*FString::Printf(TEXT("%dx%d layouts read the same tiles"), Columns, Rows), PackedChecksum, SplitChecksum);
+
+		Test.AddInfo(FString::Printf(TEXT("%dx%d linear sweep: split %.3f ms, packed %.3f ms"), Columns, Rows, SplitLinearTime * 1000.0, PackedLinearTime * 1000.0));
+		Test.AddInfo(FString::Printf(TEXT("%dx%d random sweep: split %.3f ms, packed %.3f ms"), Columns, Rows, SplitRandomTime * 1000.0, PackedRandomTime * 1000.0));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAmGridLayoutBenchmark, "AnarchistMan.AI.Grid.LayoutBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FAmGridLayoutBenchmark::RunTest(const FString& Parameters)
+{
+	AmGridLayoutBenchmark::RunLayoutBenchmark(*this, 13, 15);
+	AmGridLayoutBenchmark::RunLayoutBenchmark(*this, 101, 101);
+	AmGridLayoutBenchmark::RunLayoutBenchmark(*this, 1001, 1001);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,220 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "AI/AmGridData.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AmGridNeighbourBenchmark
+{
+	// Breadth first searches made on every grid.
+	constexpr int32 QUERIES = 100;
+
+	// Neighbour reads every sweep pass makes.
+	constexpr int64 NEIGHBOUR_READS = 20000000;
+
+	// Neighbours as they were found before the grid had neighbour masks.
+	// Every tile reported four candidates from its coordinates, out of range tiles and pillars were filtered out afterwards.
+	struct FCoordinateNeighbours
+	{
+		int32 Rows;
+
+		int32 Columns;
+
+		FORCEINLINE int32 GetNeighbourCount(FNodeRef NodeRef) const
+		{
+			return EAmGridDirection::MAX;
+		}
+
+		FORCEINLINE FNodeRef GetNeighbour(FNodeRef NodeRef, int32 NeighbourIndex) const
+		{
+			static const FIntPoint Offsets[] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+			const int32 X = NodeRef % Columns + Offsets[NeighbourIndex].X;
+			const int32 Y = NodeRef / Columns + Offsets[NeighbourIndex].Y;
+			return X >= 0 && X < Columns && Y >= 0 && Y < Rows ? Y * Columns + X : INDEX_NONE;
+		}
+
+		FORCEINLINE bool IsValidRef(FNodeRef NodeRef) const
+		{
+			if (NodeRef == INDEX_NONE)
+			{
+				return false;
+			}
+
+			const int32 X = NodeRef % Columns;
+			const int32 Y = NodeRef / Columns;
+			return X > 0 && Y > 0 && (Y % 2 == 1 || X % 2 == 1);
+		}
+	};
+
+	// Neighbours from the masks precomputed by FAmGridData, only walkable ones are reported.
+	struct FMaskNeighbours
+	{
+		const FAmGridData& Grid;
+
+		FORCEINLINE int32 GetNeighbourCount(FNodeRef NodeRef) const
+		{
+			return Grid.GetNeighbourCount(NodeRef);
+		}
+
+		FORCEINLINE FNodeRef GetNeighbour(FNodeRef NodeRef, int32 NeighbourIndex) const
+		{
+			return Grid.GetNeighbour(NodeRef, NeighbourIndex);
+		}
+
+		FORCEINLINE bool IsValidRef(FNodeRef NodeRef) const
+		{
+			return true;
+		}
+	};
+
+	struct FSearchResult
+	{
+		int64 NodesTouched = 0;
+		int64 PathLengths = 0;
+		double Time = 0.0;
+	};
+
+	// Breadth first search from every start to its goal, every neighbour candidate looked at counts as touched.
+	template <typename NeighboursType>
+	FSearchResult RunSearches(const NeighboursType& Neighbours, int32 NumNodes, const TArray<TPair<FNodeRef, FNodeRef>>& Queries)
+	{
+		TArray<int32> Distances;
+		TArray<uint32> Epochs;
+		Epochs.Init(0, NumNodes);
+		Distances.SetNumUninitialized(NumNodes);
+		TArray<FNodeRef> Queue;
+		Queue.Reserve(NumNodes);
+		uint32 Epoch = 0;
+
+		FSearchResult Result;
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (const TPair<FNodeRef, FNodeRef>& Query : Queries)
+		{
+			Epoch++;
+			Queue.Reset();
+			Queue.Add(Query.Key);
+			Epochs[Query.Key] = Epoch;
+			Distances[Query.Key] = 0;
+
+			for (int32 QueueIndex = 0; QueueIndex < Queue.Num(); QueueIndex++)
+			{
+				const FNodeRef NodeRef = Queue[QueueIndex];
+				if (NodeRef == Query.Value)
+				{
+					Result.PathLengths += Distances[NodeRef];
+					break;
+				}
+
+				const int32 NeighbourCount = Neighbours.GetNeighbourCount(NodeRef);
+				Result.NodesTouched += NeighbourCount;
+
+				for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+				{
+					const FNodeRef NeighbourRef = Neighbours.GetNeighbour(NodeRef, NeighbourIndex);
+					if (Neighbours.IsValidRef(NeighbourRef) && Epochs[NeighbourRef] != Epoch)
+					{
+						Epochs[NeighbourRef] = Epoch;
+						Distances[NeighbourRef] = Distances[NodeRef] + 1;
+						Queue.Add(NeighbourRef);
+					}
+				}
+			}
+		}
+		Result.Time = FPlatformTime::Seconds() - StartTime;
+
+		return Result;
+	}
+
+	// Visit the neighbours of every walkable tile.
+	template <typename NeighboursType>
+	double SweepNeighbours(const NeighboursType& Neighbours, const TArray<FNodeRef>& WalkableNodeRefs, int64& OutChecksum)
+	{
+		const int64 Passes = FMath::Max<int64>(1, NEIGHBOUR_READS / (WalkableNodeRefs.Num() * 4));
+
+		const double StartTime = FPlatformTime::Seconds();
+		for (int64 Pass = 0; Pass < Passes; Pass++)
+		{
+			for (FNodeRef NodeRef : WalkableNodeRefs)
+			{
+				const int32 NeighbourCount = Neighbours.GetNeighbourCount(NodeRef);
+				for (int32 NeighbourIndex = 0; NeighbourIndex < NeighbourCount; NeighbourIndex++)
+				{
+					const FNodeRef NeighbourRef = Neighbours.GetNeighbour(NodeRef, NeighbourIndex);
+					if (Neighbours.IsValidRef(NeighbourRef))
+					{
+						OutChecksum += NeighbourRef;
+					}
+				}
+			}
+		}
+		return (FPlatformTime::Seconds() - StartTime) / Passes;
+	}
+
+	void RunNeighbourBenchmark(FAutomationTestBase& Test, int32 Rows, int32 Columns, bool bRunSearches)
+	{
+		FAmGridData Grid;
+		Grid.Init(Rows, Columns);
+
+		const FCoordinateNeighbours CoordinateNeighbours{ Rows, Columns };
+		const FMaskNeighbours MaskNeighbours{ Grid };
+
+		TArray<FNodeRef> WalkableNodeRefs;
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			if (Grid.IsWalkable(NodeRef))
+			{
+				WalkableNodeRefs.Add(NodeRef);
+			}
+		}
+
+		int64 CoordinateChecksum = 0;
+		int64 MaskChecksum = 0;
+		const double CoordinateSweepTime = SweepNeighbours(CoordinateNeighbours, WalkableNodeRefs, CoordinateChecksum);
+		const double MaskSweepTime = SweepNeighbours(MaskNeighbours, WalkableNodeRefs, MaskChecksum);
+
+		Test.TestEqual(*FString::Printf(TEXT("%dx%d neighbours are the same"), Columns, Rows), MaskChecksum, CoordinateChecksum);
+		Test.AddInfo(FString::Printf(TEXT("%dx%d neighbour sweep: coordinates %.3f ms, masks %.3f ms"), Columns, Rows, CoordinateSweepTime * 1000.0, MaskSweepTime * 1000.0));
+
+		if (!bRunSearches)
+		{
+			return;
+		}
+
+		TArray<TPair<FNodeRef, FNodeRef>> Queries;
+		FRandomStream Random(Grid.Num());
+		while (Queries.Num() < QUERIES)
+		{
+			Queries.Emplace(WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())], WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())]);
+		}
+
+		const FSearchResult CoordinateResult = RunSearches(CoordinateNeighbours, Grid.Num(), Queries);
+		const FSearchResult MaskResult = RunSearches(MaskNeighbours, Grid.Num(), Queries);
+
+		Test.TestEqual(*FString::Printf(TEXT("%dx%d searches find the same paths"), Columns, Rows), MaskResult.PathLengths, CoordinateResult.PathLengths);
+		Test.TestTrue(*FString::Printf(TEXT("%dx%d masks touch fewer nodes"), Columns, Rows), MaskResult.NodesTouched < CoordinateResult.NodesTouched);
+
+		Test.AddInfo(FString::Printf(TEXT("%dx%d coordinates: %.1f nodes touched, %.3f ms per query"), Columns, Rows,
+			double(CoordinateResult.NodesTouched) / QUERIES, CoordinateResult.Time * 1000.0 / QUERIES));
+		Test.AddInfo(FString::Printf(TEXT("%dx%d masks: %.1f nodes touched, %.3f ms per query"), Columns, Rows,
+			double(MaskResult.NodesTouched) / QUERIES, MaskResult.Time * 1000.0 / QUERIES));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAmGridNeighbourBenchmark, "AnarchistMan.AI.Grid.NeighbourBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FAmGridNeighbourBenchmark::RunTest(const FString& Parameters)
+{
+	// Whole grid searches on the largest grid take too long to repeat, it is only swept.
+	AmGridNeighbourBenchmark::RunNeighbourBenchmark(*this, 13, 15, true);
+	AmGridNeighbourBenchmark::RunNeighbourBenchmark(*this, 101, 101, true);
+	AmGridNeighbourBenchmark::RunNeighbourBenchmark(*this, 1001, 1001, false);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,215 @@
+// Copyright 2022 Kiryl Antonik
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#include "AI/AmGridAStar.h"
+#include "AI/AmGridData.h"
+#include "AI/AmGridHierarchy.h"
+#include "AI/AmGridJumpPointSearch.h"
+#include "AI/AmGridQueryFilter.h"
+#include "Level/AmLevelGenerator.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AmGridSearchBenchmark
+{
+	// Path queries made on every layout.
+	constexpr int32 QUERIES = 500;
+
+	// Cluster size the nav mesh uses by default.
+	constexpr int32 HIERARCHY_CLUSTER_SIZE = 16;
+
+	// Place blocks the way AAmLevelGenerator does, BlockSpawnChance is in percent.
+	void GenerateLevel(int32 Rows, int32 Columns, float BlockSpawnChance, FAmGridData& OutGrid)
+	{
+		OutGrid.Init(Rows, Columns);
+
+		FRandomStream Random(Rows * Columns);
+		for (int32 Row = 1; Row < Rows; Row++)
+		{
+			for (int32 Column = 1; Column < Columns; Column++)
+			{
+				if (!AAmLevelGenerator::IsBreakableBlockLocation(Row, Column, Rows, Columns))
+				{
+					continue;
+				}
+
+				if (Random.RandHelper(100) >= BlockSpawnChance)
+				{
+					continue;
+				}
+
+				OutGrid.SetCost(Row * Columns + Column, ETileNavCost::BLOCK);
+			}
+		}
+	}
+
+	void RunSearchBenchmark(FAutomationTestBase& Test, const TCHAR* LayoutName, int32 Rows, int32 Columns, float BlockSpawnChance)
+	{
+		FAmGridData Grid;
+		GenerateLevel(Rows, Columns, BlockSpawnChance, Grid);
+
+		TArray<FNodeRef> WalkableNodeRefs;
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			if (Grid.IsWalkable(NodeRef))
+			{
+				WalkableNodeRefs.Add(NodeRef);
+			}
+		}
+
+		TArray<TPair<FNodeRef, FNodeRef>> Queries;
+		FRandomStream Random(Grid.Num());
+		while (Queries.Num() < QUERIES)
+		{
+			const FNodeRef StartNodeRef = WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())];
+			const FNodeRef EndNodeRef = WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())];
+			if (StartNodeRef != EndNodeRef)
+			{
+				Queries.Emplace(StartNodeRef, EndNodeRef);
+			}
+		}
+
+		const FAmGridQueryFilter QueryFilter(Grid, 1.f);
+		TArray<FAmGridPathNode> Path;
+
+		FAmGridAStar AStar;
+		AStar.Reserve(Grid.Num());
+		int64 AStarNodesExpanded = 0;
+		int64 AStarPathCost = 0;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (const TPair<FNodeRef, FNodeRef>& Query : Queries)
+		{
+			AStar.FindPath(Grid, Query.Key, Query.Value, QueryFilter, Path);
+			AStarNodesExpanded += AStar.GetNodesExpanded();
+			AStarPathCost += Path.Num() > 0 ? Path.Last().TraversalCost : 0;
+		}
+		const double AStarTime = FPlatformTime::Seconds() - StartTime;
+
+		FAmGridJumpPointSearch JumpPointSearch;
+		JumpPointSearch.Reserve(Grid.Num());
+		int64 JumpPointNodesExpanded = 0;
+		int64 JumpPointPathCost = 0;
+
+		StartTime = FPlatformTime::Seconds();
+		for (const TPair<FNodeRef, FNodeRef>& Query : Queries)
+		{
+			JumpPointSearch.FindPath(Grid, Query.Key, Query.Value, QueryFilter, Path);
+			JumpPointNodesExpanded += JumpPointSearch.GetNodesExpanded();
+			JumpPointPathCost += Path.Num() > 0 ? Path.Last().TraversalCost : 0;
+		}
+		const double JumpPointTime = FPlatformTime::Seconds() - StartTime;
+
+		Test.TestEqual(*FString::Printf(TEXT("%s %dx%d paths cost the same"), LayoutName, Columns, Rows), JumpPointPathCost, AStarPathCost);
+
+		Test.AddInfo(FString::Printf(TEXT("%s %dx%d A*: %.1f nodes expanded, %.3f ms per query"), LayoutName, Columns, Rows,
+			double(AStarNodesExpanded) / QUERIES, AStarTime * 1000.0 / QUERIES));
+		Test.AddInfo(FString::Printf(TEXT("%s %dx%d JPS: %.1f nodes expanded, %.3f ms per query"), LayoutName, Columns, Rows,
+			double(JumpPointNodesExpanded) / QUERIES, JumpPointTime * 1000.0 / QUERIES));
+	}
+
+	void RunHierarchyBenchmark(FAutomationTestBase& Test, const TCHAR* LayoutName, int32 Rows, int32 Columns, float BlockSpawnChance)
+	{
+		FAmGridData Grid;
+		GenerateLevel(Rows, Columns, BlockSpawnChance, Grid);
+
+		FAmGridHierarchy Hierarchy;
+		Hierarchy.Init(Grid, HIERARCHY_CLUSTER_SIZE);
+
+		TArray<FNodeRef> WalkableNodeRefs;
+		for (FNodeRef NodeRef = 0; NodeRef < Grid.Num(); NodeRef++)
+		{
+			if (Grid.IsWalkable(NodeRef))
+			{
+				WalkableNodeRefs.Add(NodeRef);
+			}
+		}
+
+		// Only long range queries go through the hierarchy, the nav mesh leaves the rest to A*.
+		TArray<TPair<FNodeRef, FNodeRef>> Queries;
+		FRandomStream Random(Grid.Num());
+		while (Queries.Num() < QUERIES)
+		{
+			const FNodeRef StartNodeRef = WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())];
+			const FNodeRef EndNodeRef = WalkableNodeRefs[Random.RandHelper(WalkableNodeRefs.Num())];
+			if (Hierarchy.IsLongRange(StartNodeRef, EndNodeRef))
+			{
+				Queries.Emplace(StartNodeRef, EndNodeRef);
+			}
+		}
+
+		const FAmGridQueryFilter QueryFilter(Grid, 1.f);
+		TArray<FAmGridPathNode> Path;
+
+		FAmGridAStar AStar;
+		AStar.Reserve(Grid.Num());
+		TArray<int64> AStarPathCosts;
+		int64 AStarNodesExpanded = 0;
+
+		double StartTime = FPlatformTime::Seconds();
+		for (const TPair<FNodeRef, FNodeRef>& Query : Queries)
+		{
+			AStar.FindPath(Grid, Query.Key, Query.Value, QueryFilter, Path);
+			AStarNodesExpanded += AStar.GetNodesExpanded();
+			AStarPathCosts.Add(Path.Num() > 0 ? Path.Last().TraversalCost : 0);
+		}
+		const double AStarTime = FPlatformTime::Seconds() - StartTime;
+
+		int64 AbstractNodesExpanded = 0;
+		int64 LocalNodesExpanded = 0;
+		int64 ExtraPathCost = 0;
+		int32 CostMismatches = 0;
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Queries.Num(); Index++)
+		{
+			FAmGridHierarchy::FSearchStats SearchStats;
+			Hierarchy.FindPath(Grid, Queries[Index].Key, Queries[Index].Value, QueryFilter, Path, SearchStats);
+			AbstractNodesExpanded += SearchStats.AbstractNodesExpanded;
+			LocalNodesExpanded += SearchStats.LocalNodesExpanded;
+
+			// Paths through the abstract graph may take a few extra plain steps, but never cross more blocks than needed.
+			const int64 PathCost = Path.Num() > 0 ? Path.Last().TraversalCost : 0;
+			if (PathCost < AStarPathCosts[Index] || PathCost / ETileNavCost::BLOCK != AStarPathCosts[Index] / ETileNavCost::BLOCK)
+			{
+				CostMismatches++;
+			}
+			ExtraPathCost += PathCost - AStarPathCosts[Index];
+		}
+		const double HierarchyTime = FPlatformTime::Seconds() - StartTime;
+
+		Test.TestEqual(*FString::Printf(TEXT("%s %dx%d HPA* paths cross as many blocks as A* paths"), LayoutName, Columns, Rows), CostMismatches, 0);
+
+		Test.AddInfo(FString::Printf(TEXT("%s %dx%d A*: %.1f nodes expanded, %.3f ms per query"), LayoutName, Columns, Rows,
+			double(AStarNodesExpanded) / QUERIES, AStarTime * 1000.0 / QUERIES));
+		Test.AddInfo(FString::Printf(TEXT("%s %dx%d HPA*: %.1f abstract and %.1f local nodes expanded, %.3f ms per query, %.2f extra steps"), LayoutName, Columns, Rows,
+			double(AbstractNodesExpanded) / QUERIES, double(LocalNodesExpanded) / QUERIES, HierarchyTime * 1000.0 / QUERIES,
+			double(ExtraPathCost % ETileNavCost::BLOCK) / QUERIES));
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAmGridSearchBenchmark, "AnarchistMan.AI.Grid.SearchBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FAmGridSearchBenchmark::RunTest(const FString& Parameters)
+{
+	AmGridSearchBenchmark::RunSearchBenchmark(*this, TEXT("Open"), 13, 15, 0.f);
+	AmGridSearchBenchmark::RunSearchBenchmark(*this, TEXT("Cluttered"), 13, 15, 70.f);
+	AmGridSearchBenchmark::RunSearchBenchmark(*this, TEXT("Open"), 101, 101, 0.f);
+	AmGridSearchBenchmark::RunSearchBenchmark(*this, TEXT("Cluttered"), 101, 101, 70.f);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAmGridHierarchyBenchmark, "AnarchistMan.AI.Grid.HierarchyBenchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FAmGridHierarchyBenchmark::RunTest(const FString& Parameters)
+{
+	AmGridSearchBenchmark::RunHierarchyBenchmark(*this, TEXT("Open"), 255, 255, 0.f);
+	AmGridSearchBenchmark::RunHierarchyBenchmark(*this, TEXT("Cluttered"), 255, 255, 70.f);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS